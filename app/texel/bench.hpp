@@ -0,0 +1,121 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * bench.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef BENCH_HPP_
+#define BENCH_HPP_
+
+#include "uciprotocol.hpp"
+#include "util.hpp"
+
+#include <vector>
+#include <string>
+
+/**
+ * Fixed set of positions and settings used by the "bench" command.
+ * Searching all positions to a fixed depth using one thread produces a
+ * deterministic total node count, the bench signature, which changes
+ * whenever the search or evaluation behavior changes.
+ */
+class Bench {
+public:
+    static const int defaultDepth = 10;
+    static const int defaultThreads = 1;
+    static const int defaultHash = 16;
+
+    /** Total node count when searching with the default settings. */
+    static const S64 signature;
+
+    /** Get the FEN strings of the positions in the benchmark suite. */
+    static const std::vector<std::string>& getPositions();
+
+    /** Return true if the signature is reproducible for the given settings. */
+    static bool isDefaultSetting(int depth, int threads, int hashMB);
+};
+
+/** Search listener that records node counts and suppresses all other output. */
+class BenchListener : public SearchListener {
+public:
+    explicit BenchListener(std::ostream& os);
+
+    void notifyDepth(int depth) override {}
+    void notifyCurrMove(const Move& m, int moveNr) override {}
+    void notifyPV(int depth, int score, S64 time, S64 nodes, S64 nps, bool isMate,
+                  bool upperBound, bool lowerBound, const std::vector<Move>& pv,
+                  int multiPVIndex, S64 tbHits) override {}
+    void notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) override;
+    void notifyPlayedMove(const Move& bestMove, const Move& ponderMove) override;
+
+    /** Forget the result of the previous search. */
+    void reset();
+
+    /** Number of nodes searched by the last search. */
+    S64 getNodes() const;
+
+    /** Best move found by the last search. */
+    const Move& getBestMove() const;
+
+private:
+    S64 nodes = 0;
+    Move bestMove;
+};
+
+
+inline bool
+Bench::isDefaultSetting(int depth, int threads, int hashMB) {
+    return depth == defaultDepth && threads == defaultThreads && hashMB == defaultHash;
+}
+
+inline
+BenchListener::BenchListener(std::ostream& os)
+    : SearchListener(os) {
+}
+
+inline void
+BenchListener::notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) {
+    this->nodes = nodes;
+}
+
+inline void
+BenchListener::notifyPlayedMove(const Move& bestMove, const Move& ponderMove) {
+    this->bestMove = bestMove;
+}
+
+inline void
+BenchListener::reset() {
+    nodes = 0;
+    bestMove = Move();
+}
+
+inline S64
+BenchListener::getNodes() const {
+    return nodes;
+}
+
+inline const Move&
+BenchListener::getBestMove() const {
+    return bestMove;
+}
+
+#endif /* BENCH_HPP_ */
@@ -67,7 +67,17 @@ EngineMainThread::mainLoop() {
             setupTT();
         });
         UciParams::clearHash->addListener([this]() {
-            tt.clear();
+            tt.clear(UciParams::threads->getIntPar());
+        }, false);
+        UciParams::evalFile->addListener([]() {
+            std::string fileName = UciParams::evalFile->getStringPar();
+            try {
+                Evaluate::EvalHashTables::setNetFile(fileName);
+            } catch (const ChessError& e) {
+                std::cerr << "Cluster node " << Cluster::instance().getNodeNumber()
+                          << ": failed to load network from " << fileName
+                          << ": " << e.what() << std::endl;
+            }
         }, false);
         WorkerThread worker(0, nullptr, 1, tt);
         worker.mainLoopCluster(std::move(comm));
@@ -123,13 +133,13 @@ EngineMainThread::quit() {
 void
 EngineMainThread::setupTT() {
     int hashSizeMB = UciParams::hash->getIntPar();
-    U64 nEntries = hashSizeMB > 0 ? ((U64)hashSizeMB) * (1 << 20) / sizeof(TranspositionTable::TTEntry)
+    U64 nEntries = hashSizeMB > 0 ? TranspositionTable::numEntriesForSize(((U64)hashSizeMB) * (1 << 20))
                                   : (U64)1024;
     while (true) {
         try {
             if (nEntries < 1)
                 break;
-            tt.reSize(nEntries);
+            tt.reSize(nEntries, UciParams::threads->getIntPar());
             break;
         } catch (const std::bad_alloc&) {
             nEntries /= 2;
@@ -155,6 +165,8 @@ EngineMainThread::startSearch(EngineControl* engineControl,
     Cluster::instance().assignThreads(nThreads, nThreadsThisNode, nThreadsChildren);
     comm->sendAssignThreads(nThreadsThisNode, nThreadsChildren);
     WorkerThread::createWorkers(1, comm.get(), nThreadsThisNode - 1, tt, children);
+    if (UciParams::deterministic->getBoolPar() && !Cluster::instance().isEnabled())
+        DeterministicScheduler::instance().activate(nThreadsThisNode);
 
     {
         std::lock_guard<std::mutex> L(mutex);
@@ -238,14 +250,19 @@ EngineMainThread::doSearch() {
         };
         Handler handler(comm.get());
         comm->sendStopAck(false);
+        DeterministicScheduler& sched = DeterministicScheduler::instance();
         while (true) {
             comm->poll(handler);
             if (comm->hasStopAck())
                 break;
-            notifierWait();
+            if (sched.isActive())
+                sched.yield(0);
+            else
+                notifierWait();
         }
         notifier.notify();
     }
+    DeterministicScheduler::instance().deactivate();
 }
 
 void
@@ -285,16 +302,35 @@ EngineControl::EngineControl(std::ostream& o, EngineMainThread& engineThread0,
         engineThread.setupTT();
     });
     clearHashParListenerId = UciParams::clearHash->addListener([this]() {
-        engineThread.getTT().clear();
+        engineThread.getTT().clear(UciParams::threads->getIntPar());
         ht.init();
         engineThread.setClearHistory();
     }, false);
+    saveHashParListenerId = UciParams::saveHash->addListener([this]() {
+        std::string fileName = UciParams::hashFile->getStringPar();
+        if (!engineThread.getTT().saveSnapshot(fileName))
+            os << "info string failed to save hash to " << fileName << std::endl;
+    }, false);
+    loadHashParListenerId = UciParams::loadHash->addListener([this]() {
+        std::string fileName = UciParams::hashFile->getStringPar();
+        if (!engineThread.getTT().loadSnapshot(fileName, UciParams::threads->getIntPar()))
+            os << "info string failed to load hash from " << fileName << std::endl;
+    }, false);
     opponentParListenerId = UciParams::opponent->addListener([this]() {
         setOpponent();
     });
     contemptFileParListenerId = UciParams::contemptFile->addListener([this]() {
         setOpponent();
     }, false);
+    evalFileParListenerId = UciParams::evalFile->addListener([this]() {
+        std::string fileName = UciParams::evalFile->getStringPar();
+        try {
+            Evaluate::EvalHashTables::setNetFile(fileName);
+        } catch (const ChessError& e) {
+            os << "info string failed to load network from " << fileName
+               << ": " << e.what() << std::endl;
+        }
+    }, false);
 
     et = Evaluate::getEvalHashTables();
 }
@@ -302,8 +338,11 @@ EngineControl::EngineControl(std::ostream& o, EngineMainThread& engineThread0,
 EngineControl::~EngineControl() {
     UciParams::hash->removeListener(hashParListenerId);
     UciParams::clearHash->removeListener(clearHashParListenerId);
+    UciParams::saveHash->removeListener(saveHashParListenerId);
+    UciParams::loadHash->removeListener(loadHashParListenerId);
     UciParams::opponent->removeListener(opponentParListenerId);
     UciParams::contemptFile->removeListener(contemptFileParListenerId);
+    UciParams::evalFile->removeListener(evalFileParListenerId);
 }
 
 void
@@ -345,6 +384,12 @@ EngineControl::stopSearch() {
     stopThread();
 }
 
+void
+EngineControl::waitSearch() {
+    engineThread.waitStop();
+    engineThread.waitOptionsSet();
+}
+
 void
 EngineControl::newGame() {
     randomSeed = Random().nextU64();
@@ -450,13 +495,13 @@ void
 EngineControl::startThread(int minTimeLimit, int maxTimeLimit, int earlyStopPercentage,
                            int maxDepth, int maxNodes) {
     Communicator* comm = engineThread.getCommunicator();
+    et->updateNetData();
     Search::SearchTables st(comm->getCTT(), kt, ht, *et);
     sc = std::make_shared<Search>(pos, posHashList, posHashListSize, st, *comm, treeLog);
     sc->setListener(listener);
     sc->setStrength(getStrength(), randomSeed, getMaxNPS());
     std::shared_ptr<MoveList> moves(std::make_shared<MoveList>());
-    MoveGen::pseudoLegalMoves(pos, *moves);
-    MoveGen::removeIllegal(pos, *moves);
+    MoveGen::legalMoves(pos, *moves);
     if (searchMoves.size() > 0)
         moves->filter(searchMoves);
     onePossibleMove = false;
@@ -495,6 +540,7 @@ EngineControl::startThread(int minTimeLimit, int maxTimeLimit, int earlyStopPerc
     } else {
         engineThread.getTT().nextGeneration();
     }
+    engineThread.getTT().resetStats();
     engineThread.startSearch(this, sc, pos, moves, ownBook, analyseMode, maxDepth,
                              maxNodes, maxPV, minProbeDepth, ponder, infinite);
 }
@@ -542,8 +588,7 @@ EngineControl::getPonderMove(Position pos, const Move& m) {
     if (ent.getType() != TType::T_EMPTY) {
         ent.getMove(ret);
         MoveList moves;
-        MoveGen::pseudoLegalMoves(pos, moves);
-        MoveGen::removeIllegal(pos, moves);
+        MoveGen::legalMoves(pos, moves);
         bool contains = false;
         for (int mi = 0; mi < moves.size; mi++)
             if (moves[mi] == ret) {
@@ -611,6 +656,11 @@ EngineControl::waitReady() {
 
 void
 EngineControl::finishSearch(Position& pos, const Move& bestMove) {
+    if (UciParams::hashStats->getBoolPar()) {
+        TranspositionTable::Stats stats;
+        engineThread.getTT().getStats(stats);
+        os << "info string " << stats.toString() << std::endl;
+    }
     Move ponderMove = getPonderMove(pos, bestMove);
     listener.notifyPlayedMove(bestMove, ponderMove);
 }
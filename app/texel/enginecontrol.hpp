@@ -142,6 +142,9 @@ public:
 
     void stopSearch();
 
+    /** Wait until the current search has finished without asking it to stop. */
+    void waitSearch();
+
     void newGame();
 
     static void printOptions(std::ostream& os);
@@ -183,8 +186,11 @@ private:
 
     int hashParListenerId;
     int clearHashParListenerId;
+    int saveHashParListenerId;
+    int loadHashParListenerId;
     int opponentParListenerId;
     int contemptFileParListenerId;
+    int evalFileParListenerId;
 
     EngineMainThread& engineThread;
     SearchListener& listener;
@@ -28,13 +28,17 @@
 #include "tuigame.hpp"
 #include "treeLogger.hpp"
 #include "uciprotocol.hpp"
+#include "bench.hpp"
 #include "numa.hpp"
 #include "cluster.hpp"
+#include "evaluate.hpp"
 
 #include <memory>
+#include <iostream>
 
 /** Texel chess engine main function. */
 int main(int argc, char* argv[]) {
+    int ret = 0;
     Cluster::instance().init(&argc, &argv);
     ComputerPlayer::initEngine();
     if ((argc == 2) && (std::string(argv[1]) == "txt")) {
@@ -45,10 +49,30 @@ int main(int argc, char* argv[]) {
         game.play();
     } else if ((argc == 3) && (std::string(argv[1]) == "tree")) {
         TreeLoggerReader::main(argv[2]);
+    } else if ((argc >= 2) && (argc <= 5) && (std::string(argv[1]) == "bench")) {
+        int par[3] = { Bench::defaultDepth, Bench::defaultThreads, Bench::defaultHash };
+        for (int i = 2; i < argc; i++)
+            str2Num(std::string(argv[i]), par[i-2]);
+        if (!UCIProtocol::runBench(par[0], par[1], par[2]))
+            ret = 1;
+    } else if ((argc == 3) && (std::string(argv[1]) == "nnimage")) {
+        if (!Evaluate::EvalHashTables::getNetData()->saveImage(argv[2])) {
+            std::cerr << "Failed to write network image " << argv[2] << std::endl;
+            ret = 1;
+        }
     } else {
-        if ((argc == 2) && (std::string(argv[1]) == "-nonuma"))
-            Numa::instance().disable();
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg == "-nonuma") {
+                Numa::instance().disable();
+            } else if (arg == "-nnimage" && i + 1 < argc) {
+                std::string file(argv[++i]);
+                if (!Evaluate::EvalHashTables::useNetImage(file))
+                    std::cerr << "Cannot use network image " << file << std::endl;
+            }
+        }
         UCIProtocol::main(false);
     }
     Cluster::instance().finalize();
+    return ret;
 }
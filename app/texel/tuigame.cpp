@@ -25,6 +25,7 @@
 
 #include "tuigame.hpp"
 #include "uciprotocol.hpp"
+#include "bench.hpp"
 #include "textio.hpp"
 #include "evaluate.hpp"
 #include "computerPlayer.hpp"
@@ -52,6 +53,14 @@ TUIGame::handleCommand(const std::string& moveStr) {
         UCIProtocol::main(true);
         exit(0);
         return false;
+    } else if ((moveStr == "bench") || startsWith(moveStr, "bench ")) {
+        std::vector<std::string> args;
+        splitString(moveStr, args);
+        int par[3] = { Bench::defaultDepth, Bench::defaultThreads, Bench::defaultHash };
+        for (size_t i = 1; i < args.size() && i <= 3; i++)
+            str2Num(args[i], par[i-1]);
+        UCIProtocol::runBench(par[0], par[1], par[2]);
+        return true;
     } else if (moveStr == "help") {
         showHelp();
         return true;
@@ -80,6 +89,8 @@ TUIGame::showHelp() {
     std::cout << "  book on|off     - Turn opening book on/off" << std::endl;
     std::cout << "  time t          - Set computer thinking time, ms" << std::endl;
     std::cout << "  perft d         - Run perft test to depth d" << std::endl;
+    std::cout << "  bench [d t h]   - Search benchmark positions to depth d," << std::endl;
+    std::cout << "                    using t threads and h MB hash" << std::endl;
     std::cout << "  uci             - Switch to uci protocol." << std::endl;
     std::cout << "  help            - Show this help" << std::endl;
     std::cout << "  quit            - Terminate program" << std::endl;
@@ -24,13 +24,17 @@
  */
 
 #include "uciprotocol.hpp"
+#include "bench.hpp"
+#include "perft.hpp"
 #include "searchparams.hpp"
 #include "computerPlayer.hpp"
 #include "textio.hpp"
 #include "logger.hpp"
 #include "cluster.hpp"
+#include "timeUtil.hpp"
 
 #include <iostream>
+#include <iomanip>
 
 
 SearchListener::SearchListener(std::ostream& os)
@@ -133,6 +137,21 @@ UCIProtocol::main(bool autoStart) {
     thread.join();
 }
 
+bool
+UCIProtocol::runBench(int depth, int threads, int hashMB) {
+    UCIProtocol uciProt(std::cin, std::cout);
+    bool ok = true;
+    auto f = [&]() {
+        if (Cluster::instance().isMasterNode())
+            ok = uciProt.bench(depth, threads, hashMB, uciProt.os);
+        uciProt.engineThread.quit();
+    };
+    std::thread thread(f);
+    uciProt.engineThread.mainLoop();
+    thread.join();
+    return ok;
+}
+
 UCIProtocol::UCIProtocol(std::istream& is, std::ostream& os)
     : is(is), os(os), pos(TextIO::readFEN(TextIO::startPosFEN)),
       searchListener(os), quit(false) {
@@ -169,7 +188,8 @@ UCIProtocol::handleCommand(const std::string& cmdLine, std::ostream& os) {
     try {
         std::string cmd = tokens[0];
         if (cmd == "uci") {
-            os << "id name " << ComputerPlayer::engineName << std::endl;
+            os << "id name " << ComputerPlayer::engineName << ' '
+               << ComputerPlayer::getCpuFeatures() << std::endl;
             os << "id author Peter Osterlund" << std::endl;
             EngineControl::printOptions(os);
             os << "uciok" << std::endl;
@@ -229,6 +249,10 @@ UCIProtocol::handleCommand(const std::string& cmdLine, std::ostream& os) {
                     }
                 }
             }
+        } else if ((cmd == "go") && (nTok > 2) && (tokens[1] == "perft")) {
+            int depth;
+            if (str2Num(tokens[2], depth))
+                perft(depth, os);
         } else if (cmd == "go") {
             initEngine(os);
             int idx = 1;
@@ -287,6 +311,17 @@ UCIProtocol::handleCommand(const std::string& cmdLine, std::ostream& os) {
                 engine->stopSearch();
         } else if (cmd == "ponderhit") {
             engine->ponderHit();
+        } else if (cmd == "bench") {
+            int depth = Bench::defaultDepth;
+            int threads = Bench::defaultThreads;
+            int hashMB = Bench::defaultHash;
+            if (nTok > 1)
+                str2Num(tokens[1], depth);
+            if (nTok > 2)
+                str2Num(tokens[2], threads);
+            if (nTok > 3)
+                str2Num(tokens[3], hashMB);
+            bench(depth, threads, hashMB, os);
         } else if (cmd == "quit") {
             if (engine)
                 engine->stopSearch();
@@ -302,6 +337,77 @@ UCIProtocol::initEngine(std::ostream& os) {
         engine = ::make_unique<EngineControl>(os, engineThread, searchListener);
 }
 
+bool
+UCIProtocol::bench(int depth, int threads, int hashMB, std::ostream& os) {
+    if (engine) {
+        engine->stopSearch();
+        engine.reset();
+    }
+    const int oldThreads = UciParams::threads->getIntPar();
+    const int oldHash = UciParams::hash->getIntPar();
+
+    BenchListener listener(os);
+    S64 totNodes = 0;
+    S64 totTime = 0;
+    {
+        EngineControl benchEngine(os, engineThread, listener);
+        benchEngine.setOption("threads", num2Str(threads));
+        benchEngine.setOption("hash", num2Str(hashMB));
+        benchEngine.waitReady();
+
+        SearchParams sPar;
+        sPar.depth = depth;
+        const std::vector<std::string>& fens = Bench::getPositions();
+        const int nPos = fens.size();
+        for (int i = 0; i < nPos; i++) {
+            Position benchPos = TextIO::readFEN(fens[i]);
+            benchEngine.newGame();
+            benchEngine.waitReady();
+            listener.reset();
+            S64 t0 = currentTimeMillis();
+            benchEngine.startSearch(benchPos, std::vector<Move>(), sPar);
+            benchEngine.waitSearch();
+            S64 t = currentTimeMillis() - t0;
+            totNodes += listener.getNodes();
+            totTime += t;
+            os << "Position " << std::setw(2) << (i + 1) << '/' << nPos
+               << " nodes " << std::setw(10) << listener.getNodes()
+               << " time " << std::setw(6) << t
+               << " bestmove " << TextIO::moveToUCIString(listener.getBestMove())
+               << std::endl;
+        }
+
+        benchEngine.setOption("threads", num2Str(oldThreads));
+        benchEngine.setOption("hash", num2Str(oldHash));
+        benchEngine.newGame();
+        benchEngine.waitReady();
+    }
+
+    S64 nps = totTime > 0 ? totNodes * 1000 / totTime : 0;
+    os << "Total time (ms) : " << totTime << std::endl;
+    os << "Nodes searched  : " << totNodes << std::endl;
+    os << "Nodes/second    : " << nps << std::endl;
+
+    if (!Bench::isDefaultSetting(depth, threads, hashMB))
+        return true;
+    if (totNodes != Bench::signature) {
+        os << "Signature mismatch, expected " << Bench::signature << std::endl;
+        return false;
+    }
+    os << "Signature OK" << std::endl;
+    return true;
+}
+
+void
+UCIProtocol::perft(int depth, std::ostream& os) {
+    Position perftPos(pos);
+    UndoInfo ui;
+    for (const Move& m : moves)
+        perftPos.makeMove(m, ui);
+    Perft perft(UciParams::threads->getIntPar(), UciParams::hash->getIntPar());
+    perft.report(perftPos, depth, os);
+}
+
 /** Convert a string to tokens by splitting at whitespace characters. */
 void
 UCIProtocol::tokenize(const std::string& cmdLine, std::vector<std::string>& tokens) {
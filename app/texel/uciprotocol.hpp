@@ -51,7 +51,7 @@ public:
 
     void notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) override;
 
-    void notifyPlayedMove(const Move& bestMove, const Move& ponderMove);
+    virtual void notifyPlayedMove(const Move& bestMove, const Move& ponderMove);
 
 private:
     static std::string moveToString(const Move& m);
@@ -66,6 +66,10 @@ class UCIProtocol {
 public:
     static void main(bool autoStart);
 
+    /** Run the benchmark suite and then return.
+     *  @return False if the node count signature did not match. */
+    static bool runBench(int depth, int threads, int hashMB);
+
     UCIProtocol(std::istream& is, std::ostream& os);
 
     void mainLoop(bool autoStart);
@@ -75,6 +79,14 @@ private:
 
     void initEngine(std::ostream& os);
 
+    /** Search all benchmark positions and report node count and speed.
+     *  @return False if the node count signature did not match. */
+    bool bench(int depth, int threads, int hashMB, std::ostream& os);
+
+    /** Compute perft(depth) for the current position using the Threads and
+     *  Hash settings, and report node counts and speed. */
+    void perft(int depth, std::ostream& os);
+
     /** Convert a string to tokens by splitting at whitespace characters. */
     void tokenize(const std::string& cmdLine, std::vector<std::string>& tokens);
 
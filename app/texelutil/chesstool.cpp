@@ -698,6 +698,48 @@ ChessTool::searchPositions(std::istream& is, int baseTime, int increment) {
     pool.getAllResults([](int){});
 }
 
+void
+ChessTool::hashStats(std::istream& is, int hashMB, int depth) {
+    TranspositionTable tt(TranspositionTable::numEntriesForSize((U64)hashMB << 20));
+    Notifier notifier;
+    ThreadCommunicator comm(nullptr, tt, notifier, false);
+    std::vector<U64> nullHist(SearchConst::MAX_SEARCH_DEPTH * 2);
+    KillerTable kt;
+    History ht;
+    auto et = Evaluate::getEvalHashTables();
+    TreeLogger treeLog;
+    Search::SearchTables st(comm.getCTT(), kt, ht, *et);
+    Position pos;
+    Search sc(pos, nullHist, 0, st, comm, treeLog);
+    int minProbeDepth = UciParams::minProbeDepth->getIntPar();
+
+    std::string line;
+    while (true) {
+        std::getline(is, line);
+        if (!is || is.eof())
+            break;
+        std::vector<std::string> fields;
+        splitString(line, " : ", fields);
+        pos = TextIO::readFEN(fields[0]);
+
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(pos, moves);
+        MoveGen::removeIllegal(pos, moves);
+        if (moves.size == 0)
+            continue;
+
+        tt.nextGeneration();
+        sc.init(pos, nullHist, 0);
+        sc.timeLimit(-1, -1);
+        sc.iterativeDeepening(moves, depth, -1, 1, false, minProbeDepth);
+    }
+
+    TranspositionTable::Stats stats;
+    tt.getStats(stats);
+    std::cout << stats.toString() << std::endl;
+    std::cout << "hashfull " << tt.getHashFull() << std::endl;
+}
+
 void
 ChessTool::fen2bin(std::istream& is, const std::string& outFile, bool useResult,
                    bool noInCheck, double prLimit) {
@@ -145,6 +145,10 @@ public:
      *  not generate any output, but it is still useful if the SearchTreeSampler is enabled. */
     void searchPositions(std::istream& is, int baseTime, int increment);
 
+    /** Search all positions in a FEN file to a fixed depth, using one shared
+     *  transposition table, and print transposition table statistics. */
+    void hashStats(std::istream& is, int hashMB, int depth);
+
     /** Convert FEN+score data to binary format.
      *  If "useResult" is true, use the game result instead of the search score.
      *  If "noInCheck" is true, ignore positions where side to move is in check.
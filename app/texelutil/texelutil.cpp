@@ -32,6 +32,7 @@
 #include "revmovegen.hpp"
 #include "matchbookcreator.hpp"
 #include "tbgen.hpp"
+#include "perft.hpp"
 #include "parameters.hpp"
 #include "chessError.hpp"
 #include "computerPlayer.hpp"
@@ -99,6 +100,7 @@ usage() {
 #endif
     std::cerr << " qsearch : Update positions in FEN file to position at end of q-search\n";
     std::cerr << " searchfens time inc : Search all positions in FEN file\n";
+    std::cerr << " hashstats hashMB depth : Search all positions in FEN file, print hash statistics\n";
     std::cerr << " fen2bin [-useResult] [-noincheck] [-prlimit lim] outFile\n";
     std::cerr << "                     : Convert FEN+score data to binary format\n";
     std::cerr << "\n";
@@ -164,6 +166,8 @@ usage() {
     std::cerr << " proofgame -f [-o outfile] [-retry] [-rnd seed] [-rndkernel]\n";
     std::cerr << " proofkernel [-i \"initFen\"] \"goalFen\"\n";
     std::cerr << " revmoves \"fen\"\n";
+    std::cerr << "\n";
+    std::cerr << " perft [-h hashMB] depth [\"fen\"] : Count leaf nodes, print count for each move\n";
     std::cerr << std::flush;
     ::exit(2);
 }
@@ -569,6 +573,30 @@ doRevMoves(const std::string& fen) {
     }
 }
 
+static void
+doPerftCmd(int argc, char* argv[], int nWorkers) {
+    int hashMB = 256;
+    int arg = 2;
+    if (arg + 1 < argc && argv[arg] == std::string("-h")) {
+        if (!str2Num(argv[arg+1], hashMB) || hashMB < 0)
+            usage();
+        arg += 2;
+    }
+    int depth;
+    if (arg >= argc || !str2Num(argv[arg], depth) || depth < 0)
+        usage();
+    arg++;
+    std::string fen = TextIO::startPosFEN;
+    if (arg < argc)
+        fen = argv[arg++];
+    if (arg != argc)
+        usage();
+
+    Position pos = TextIO::readFEN(fen);
+    Perft perft(nWorkers, hashMB);
+    perft.report(pos, depth, std::cout);
+}
+
 int
 main(int argc, char* argv[]) {
     std::ios::sync_with_stdio(false);
@@ -648,6 +676,14 @@ main(int argc, char* argv[]) {
                 !str2Num(argv[3], increment) || (increment < 0))
                 usage();
             chessTool.searchPositions(std::cin, baseTime, increment);
+        } else if (cmd == "hashstats") {
+            if (argc != 4)
+                usage();
+            int hashMB = 0, depth = 0;
+            if (!str2Num(argv[2], hashMB) || (hashMB <= 0) ||
+                !str2Num(argv[3], depth) || (depth <= 0))
+                usage();
+            chessTool.hashStats(std::cin, hashMB, depth);
         } else if (cmd == "fen2bin") {
             doFen2Bin(argc, argv, chessTool);
         } else if (cmd == "outliers") {
@@ -917,6 +953,8 @@ main(int argc, char* argv[]) {
             doProofGameCmd(argc, argv, nWorkers);
         } else if (cmd == "proofkernel") {
             doProofKernelCmd(argc, argv, nWorkers);
+        } else if (cmd == "perft") {
+            doPerftCmd(argc, argv, nWorkers);
         } else if (cmd == "revmoves") {
             if (argc != 3)
                 usage();
@@ -615,10 +615,11 @@ getQLoss(DataSet& ds, const NetData& qNet, int nWorkers) {
         DataSet ds;
         std::shared_ptr<NNEvaluator> qEval;
         Record r;
-        Position pos;
+        std::vector<Position> positions;
+        std::vector<int> targets;
+        std::vector<int> qVals;
         ThreadData(DataSet& ds, const NetData& net) : ds(ds) {
             qEval = NNEvaluator::create(net);
-            qEval->connectPosition(&pos);
         }
     };
     std::vector<std::shared_ptr<ThreadData>> tdVec(nWorkers);
@@ -634,15 +635,22 @@ getQLoss(DataSet& ds, const NetData& qNet, int nWorkers) {
         S64 endIdx = std::min(i + batchSize, nPos);
         auto func = [&tdVec,beginIdx,endIdx](int workerNo) {
             ThreadData& td = *tdVec[workerNo];
+            const int chunkSize = 1024;
+            td.positions.resize(chunkSize);
+            td.targets.resize(chunkSize);
+            td.qVals.resize(chunkSize);
             double qLoss = 0;
-            for (S64 i = beginIdx; i < endIdx; i++) {
-                td.ds.getItem(i, td.r);
-                int target;
-                NNUtil::recordToPos(td.r, td.pos, target);
-
-                int qVal = td.qEval->eval();
-                double err = toProb(qVal*0.01) - toProb(target*0.01);
-                qLoss += err*err;
+            for (S64 i = beginIdx; i < endIdx; i += chunkSize) {
+                const int n = std::min((S64)chunkSize, endIdx - i);
+                for (int j = 0; j < n; j++) {
+                    td.ds.getItem(i + j, td.r);
+                    NNUtil::recordToPos(td.r, td.positions[j], td.targets[j]);
+                }
+                td.qEval->evalBatch(&td.positions[0], n, &td.qVals[0]);
+                for (int j = 0; j < n; j++) {
+                    double err = toProb(td.qVals[j]*0.01) - toProb(td.targets[j]*0.01);
+                    qLoss += err*err;
+                }
             }
             return qLoss;
         };
@@ -835,7 +843,7 @@ printStats(const NetData& net) {
                     for (int pt = 0; pt < 5; pt++) {
                         int idx1, idx2, idx3;
                         toIndex(kIdx, c*5+pt, sq, idx1, idx2, idx3);
-                        int val = net.weight1(idx1, f);
+                        int val = net.getWeight1(idx1, f);
                         minSqV = std::min(minSqV, val);
                         maxSqV = std::max(maxSqV, val);
                     }
@@ -940,7 +948,7 @@ static void
 quantize(const std::string& inFile, const std::string& outFile,
          const std::string& validationFile,
          bool compress, bool permute, bool useLocalSearch, U64 rndSeed,
-         bool qLoss, int nWorkers) {
+         bool weight1S8, bool qLoss, int nWorkers) {
     auto netP = std::make_shared<Net>();
     Net& net = *netP;
     torch::load(netP, inFile.c_str());
@@ -955,6 +963,9 @@ quantize(const std::string& inFile, const std::string& outFile,
         permuteFeatures(qNet, ds, useLocalSearch, rndSeed, nWorkers);
     }
 
+    if (weight1S8)
+        qNet.quantizeWeight1();
+
     {
         std::ofstream os;
         os.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -1184,11 +1195,12 @@ usage() {
     std::cerr << "cmd is one of:\n";
     std::cerr << " train [-i modelfile] [-lr rate] [-epochs n] [-qat] infile\n";
     std::cerr << "   Train network from data in infile\n";
-    std::cerr << " quant [-c] [-p|-pl] [-ql] infile outfile [validationFile]\n";
+    std::cerr << " quant [-c] [-p|-pl] [-q8] [-ql] infile outfile [validationFile]\n";
     std::cerr << "   Quantize infile, write result to outfile\n";
     std::cerr << "   -c       : Also create compressed network\n";
     std::cerr << "   -p       : Permute features for sparsity using validationFile\n";
     std::cerr << "   -pl seed : Permute features using local search. seed=0 uses current time\n";
+    std::cerr << "   -q8      : Use 8-bit first layer weights with per output scaling\n";
     std::cerr << "   -ql      : Compute RMS loss for quantized net using validationFile\n";
     std::cerr << " eval modelfile fen\n";
     std::cerr << "   Evaluate position using a saved network\n";
@@ -1260,6 +1272,7 @@ doQuantize(int argc, char* argv[], int nWorkers) {
     bool permute = false;
     bool useLocalSearch = false;
     U64 rndSeed = 0;
+    bool weight1S8 = false;
     bool qLoss = false;
 
     argc -= 2;
@@ -1281,6 +1294,10 @@ doQuantize(int argc, char* argv[], int nWorkers) {
             useLocalSearch = true;
             argc -= 2;
             argv += 2;
+        } else if (arg == "-q8") {
+            weight1S8 = true;
+            argc--;
+            argv++;
         } else if (arg == "-ql") {
             qLoss = true;
             argc--;
@@ -1299,7 +1316,7 @@ doQuantize(int argc, char* argv[], int nWorkers) {
     if (!validationFile.empty())
         checkFileExists(validationFile);
     quantize(inFile, outFile, validationFile, compress, permute,
-             useLocalSearch, rndSeed, qLoss, nWorkers);
+             useLocalSearch, rndSeed, weight1S8, qLoss, nWorkers);
 }
 
 int
@@ -122,6 +122,29 @@ const SqTbl<U64> BitBoard::bMagics = {
 
 vector_aligned<U64> BitBoard::tableData;
 
+#ifdef HAS_RUNTIME_BMI2
+bool BitBoard::pextEnabled = false;
+
+/** Return true if the CPU has a fast PEXT instruction. AMD family 17h CPUs
+ *  (Zen 1 and Zen 2) implement PEXT in microcode, which is slower than
+ *  magic bitboards. */
+static bool
+hasFastPext() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam17h");
+}
+#endif
+
+#ifdef HAS_RUNTIME_POPCNT
+static bool
+hasPopcntInstr() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+}
+
+bool BitUtil::popcntEnabled = hasPopcntInstr();
+#endif
+
 const S8 BitBoard::dirTable[] = {
        -9,  0,  0,  0,  0,  0,  0, -8,  0,  0,  0,  0,  0,  0, -7,
     0,  0, -9,  0,  0,  0,  0,  0, -8,  0,  0,  0,  0,  0, -7,  0,
@@ -277,7 +300,45 @@ BitBoard::staticInitialize() {
         bPawnBlockerMaskTable[sq] = m;
     }
 
-#ifdef HAS_BMI2
+#if defined(HAS_BMI2)
+    initPextTables();
+#elif defined(HAS_RUNTIME_BMI2)
+    pextEnabled = hasFastPext();
+    if (pextEnabled)
+        initPextTables();
+    else
+        initMagicTables();
+#else
+    initMagicTables();
+#endif
+
+    // squaresBetween
+    for (Square sq1 : AllSquares()) {
+        for (Square j : AllSquares())
+            squaresBetweenTable[sq1][j] = 0;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if ((dx == 0) && (dy == 0))
+                    continue;
+                U64 m = 0;
+                int x = sq1.getX();
+                int y = sq1.getY();
+                while (true) {
+                    x += dx; y += dy;
+                    if ((x < 0) || (x > 7) || (y < 0) || (y > 7))
+                        break;
+                    Square sq2(x, y);
+                    squaresBetweenTable[sq1][sq2] = m;
+                    m |= 1ULL << sq2;
+                }
+            }
+        }
+    }
+}
+
+#if defined(HAS_BMI2) || defined(HAS_RUNTIME_BMI2)
+void
+BitBoard::initPextTables() {
     int tdSize = 0;
     for (Square sq : AllSquares()) {
         int x = sq.getX();
@@ -317,7 +378,12 @@ BitBoard::staticInitialize() {
         }
         bTables[sq] = table;
     }
-#else
+}
+#endif
+
+#ifndef HAS_BMI2
+void
+BitBoard::initMagicTables() {
     int rTableSize = 0;
     for (Square sq : AllSquares())
         rTableSize += 1 << (64 - rBits[sq]);
@@ -374,28 +440,5 @@ BitBoard::staticInitialize() {
         }
         bTables[sq] = table;
     }
-#endif
-
-    // squaresBetween
-    for (Square sq1 : AllSquares()) {
-        for (Square j : AllSquares())
-            squaresBetweenTable[sq1][j] = 0;
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                if ((dx == 0) && (dy == 0))
-                    continue;
-                U64 m = 0;
-                int x = sq1.getX();
-                int y = sq1.getY();
-                while (true) {
-                    x += dx; y += dy;
-                    if ((x < 0) || (x > 7) || (y < 0) || (y > 7))
-                        break;
-                    Square sq2(x, y);
-                    squaresBetweenTable[sq1][sq2] = m;
-                    m |= 1ULL << sq2;
-                }
-            }
-        }
-    }
 }
+#endif
@@ -45,6 +45,14 @@
 inline U64 pext(U64 value, U64 mask) {
     return _pext_u64(value, mask);
 }
+#elif defined(HAS_RUNTIME_BMI2)
+/** Inline assembly, because the code is not compiled with -mbmi2.
+ *  Only used if the CPU supports BMI2. */
+inline U64 pext(U64 value, U64 mask) {
+    U64 ret;
+    asm("pext %2, %1, %0" : "=r" (ret) : "r" (value), "rm" (mask));
+    return ret;
+}
 #endif
 
 class BitUtil {
@@ -61,8 +69,14 @@ public:
     /** Return number of 1 bits in mask. */
     static int bitCount(U64 mask);
 
+    /** Return true if bitCount() uses the popcnt instruction. */
+    static bool hasPopcnt();
+
 private:
     static const int trailingZ[64], lastBitTable[64];
+#ifdef HAS_RUNTIME_POPCNT
+    static bool popcntEnabled; // True if the CPU supports popcnt
+#endif
 };
 
 class BitBoard {
@@ -159,7 +173,18 @@ public:
     /** Initialize static data. */
     static void staticInitialize();
 
+    /** Return true if slider attacks are computed using the PEXT instruction
+     *  instead of magic multiplication. */
+    static bool hasPext();
+
 private:
+#if defined(HAS_BMI2) || defined(HAS_RUNTIME_BMI2)
+    static void initPextTables();
+#endif
+#ifndef HAS_BMI2
+    static void initMagicTables();
+#endif
+
     /** Squares attacked by a king on a given square. */
     static SqTbl<U64> kingAttacksTable;
     static SqTbl<U64> knightAttacksTable;
@@ -183,6 +208,9 @@ private:
     static const SqTbl<U64> bMagics;
 
     static vector_aligned<U64> tableData;
+#ifdef HAS_RUNTIME_BMI2
+    static bool pextEnabled; // True if the CPU has a fast PEXT instruction
+#endif
 
     static const S8 dirTable[];
 };
@@ -254,6 +282,13 @@ BitUtil::bitCount(U64 mask) {
                __builtin_popcountl(mask & 0xffffffffULL);
 #endif
 #else
+#ifdef HAS_RUNTIME_POPCNT
+    if (popcntEnabled) {
+        U64 ret;
+        asm("popcnt %1, %0" : "=r" (ret) : "rm" (mask) : "cc");
+        return (int)ret;
+    }
+#endif
     const U64 k1 = 0x5555555555555555ULL;
     const U64 k2 = 0x3333333333333333ULL;
     const U64 k4 = 0x0f0f0f0f0f0f0f0fULL;
@@ -267,6 +302,17 @@ BitUtil::bitCount(U64 mask) {
 #endif
 }
 
+inline bool
+BitUtil::hasPopcnt() {
+#if defined(HAS_POPCNT)
+    return true;
+#elif defined(HAS_RUNTIME_POPCNT)
+    return popcntEnabled;
+#else
+    return false;
+#endif
+}
+
 inline U64
 BitBoard::mirrorX(U64 mask) {
     U64 k1 = 0x5555555555555555ULL;
@@ -295,6 +341,10 @@ BitBoard::bishopAttacks(Square sq, U64 occupied) {
 #ifdef HAS_BMI2
     return bTables[sq][pext(occupied, bMasks[sq])];
 #else
+#ifdef HAS_RUNTIME_BMI2
+    if (pextEnabled)
+        return bTables[sq][pext(occupied, bMasks[sq])];
+#endif
     return bTables[sq][(int)(((occupied & bMasks[sq]) * bMagics[sq]) >> bBits[sq])];
 #endif
 }
@@ -304,6 +354,10 @@ BitBoard::rookAttacks(Square sq, U64 occupied) {
 #ifdef HAS_BMI2
     return rTables[sq][pext(occupied, rMasks[sq])];
 #else
+#ifdef HAS_RUNTIME_BMI2
+    if (pextEnabled)
+        return rTables[sq][pext(occupied, rMasks[sq])];
+#endif
     return rTables[sq][(int)(((occupied & rMasks[sq]) * rMagics[sq]) >> rBits[sq])];
 #endif
 }
@@ -378,4 +432,15 @@ BitBoard::bitCount(U64 mask) {
     return BitUtil::bitCount(mask);
 }
 
+inline bool
+BitBoard::hasPext() {
+#if defined(HAS_BMI2)
+    return true;
+#elif defined(HAS_RUNTIME_BMI2)
+    return pextEnabled;
+#else
+    return false;
+#endif
+}
+
 #endif /* BITBOARD_HPP_ */
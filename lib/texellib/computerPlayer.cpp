@@ -31,6 +31,7 @@
 #include "clustertt.hpp"
 #include "textio.hpp"
 #include "tbprobe.hpp"
+#include "nnkernels.hpp"
 
 #include <iostream>
 
@@ -69,6 +70,16 @@ ComputerPlayer::initEngine() {
     kV.addListener([]() { pieceValue[Piece::WKING]   = pieceValue[Piece::BKING]   = kV; });
 }
 
+std::string
+ComputerPlayer::getCpuFeatures() {
+    std::string ret = NNKernels::instance().name;
+    if (BitBoard::hasPext())
+        ret += " bmi2";
+    if (BitUtil::hasPopcnt())
+        ret += " popcnt";
+    return ret;
+}
+
 ComputerPlayer::ComputerPlayer()
     : tt(32*1024), book(false) {
     initEngine();
@@ -70,6 +70,10 @@ public:
     /** Performs initialization that must happen after static initialization. */
     static void initEngine();
 
+    /** Return a description of the CPU specific code used by the engine,
+     *  for example "avx2 popcnt". */
+    static std::string getCpuFeatures();
+
 private:
     /** Check if a draw claim is allowed, possibly after playing "move".
      * @param move The move that may have to be made before claiming draw.
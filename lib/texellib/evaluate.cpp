@@ -30,6 +30,9 @@
 #include "chessError.hpp"
 #include "incbin.h"
 #include <vector>
+#include <istream>
+#include <fstream>
+#include <mutex>
 
 extern "C" {
 #include "Lzma86Dec.h"
@@ -269,12 +272,52 @@ Evaluate::getEvalHashTables() {
 Evaluate::EvalHashTables::EvalHashTables() {
     pawnHash.resize(1 << 16);
     materialHash.resize(1 << 14);
-    nnEval = NNEvaluator::create(initNetData());
+    netData = getNetData();
+    nnEval = NNEvaluator::create(*netData);
 }
 
-const NetData&
-Evaluate::EvalHashTables::initNetData() {
-    static std::shared_ptr<NetData> staticNetData = []() {
+void
+Evaluate::EvalHashTables::updateNetData() {
+    std::shared_ptr<const NetData> net = getNetData();
+    if (net != netData) {
+        nnEval = NNEvaluator::create(*net);
+        netData = net;
+        evalHash.fill(EvalHashData()); // Cached scores are from the old network
+    }
+}
+
+/** Network image set by useNetImage(), or null to use the embedded network. */
+static std::shared_ptr<const NetData> netImage;
+
+/** Network set by setNetFile(), or null to use the default network. */
+static std::shared_ptr<const NetData> netFromFile;
+static std::mutex netMutex;
+
+bool
+Evaluate::EvalHashTables::useNetImage(const std::string& filename) {
+    netImage = NetData::mapImage(filename);
+    return netImage != nullptr;
+}
+
+namespace {
+/** Stream buffer reading directly from a memory area. */
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(char* data, size_t size) {
+        setg(data, data, data + size);
+    }
+};
+}
+
+std::shared_ptr<const NetData>
+Evaluate::EvalHashTables::getNetData() {
+    std::lock_guard<std::mutex> L(netMutex);
+    if (netFromFile)
+        return netFromFile;
+    static std::shared_ptr<const NetData> staticNetData = []() -> std::shared_ptr<const NetData> {
+        if (netImage)
+            return netImage;
+
         std::shared_ptr<NetData> netData = NetData::create();
         size_t unCompressedSize = netData->computeSize();
         std::vector<unsigned char> unComprData(unCompressedSize);
@@ -284,12 +327,30 @@ Evaluate::EvalHashTables::initNetData() {
         if (res != SZ_OK)
             throw ChessError("Failed to decompress network data");
 
-        std::string nnData((char*)unComprData.data(), unCompressedSize);
-        std::stringstream is(nnData);
+        MemoryStreamBuf buf((char*)unComprData.data(), unCompressedSize);
+        std::istream is(&buf);
         netData->load(is);
         return netData;
     }();
-    return *staticNetData;
+    return staticNetData;
+}
+
+void
+Evaluate::EvalHashTables::setNetFile(const std::string& filename) {
+    std::shared_ptr<const NetData> net;
+    if (!filename.empty()) {
+        net = NetData::mapImage(filename);
+        if (!net) {
+            std::ifstream is(filename, std::ios::binary);
+            if (!is)
+                throw ChessError("Cannot open file: " + filename);
+            std::shared_ptr<NetData> netData = NetData::create();
+            netData->load(is);
+            net = netData;
+        }
+    }
+    std::lock_guard<std::mutex> L(netMutex);
+    netFromFile = net;
 }
 
 int
@@ -68,9 +68,28 @@ public:
         using EvalHashType = std::array<EvalHashData,(1<<16)>;
         EvalHashType evalHash;
 
+        std::shared_ptr<const NetData> netData;
         std::shared_ptr<NNEvaluator> nnEval;
-    private:
-        const NetData& initNetData();
+
+        /** Switch to the current network if it has changed since this object
+         *  was created. Must not be called while the object is in use. */
+        void updateNetData();
+
+        /** Get the network used for evaluation. */
+        static std::shared_ptr<const NetData> getNetData();
+
+        /** Use a network file instead of the default network for all
+         *  subsequently created or updated EvalHashTables objects. The file can
+         *  be a NetData file or a network image file. An empty file name
+         *  restores the default network.
+         *  @throws ChessError if the file could not be loaded. */
+        static void setNetFile(const std::string& filename);
+
+        /** Use a network image file created by NetData::saveImage() instead of
+         *  the network embedded in the program. Must be called before the
+         *  first EvalHashTables object is created.
+         *  @return False if the image file could not be used. */
+        static bool useNetImage(const std::string& filename);
     };
 
     /** Constructor. */
@@ -110,8 +110,7 @@ Game::getGameStateString() {
 Game::GameState
 Game::getGameState() {
     MoveList moves;
-    MoveGen::pseudoLegalMoves(pos, moves);
-    MoveGen::removeIllegal(pos, moves);
+    MoveGen::legalMoves(pos, moves);
     if (moves.size == 0) {
         if (MoveGen::inCheck(pos))
             return pos.isWhiteMove() ? BLACK_MATE : WHITE_MATE;
@@ -472,8 +471,7 @@ Game::perfT(Position& pos, int depth) {
         return 1;
     U64 nodes = 0;
     MoveList moves;
-    MoveGen::pseudoLegalMoves(pos, moves);
-    MoveGen::removeIllegal(pos, moves);
+    MoveGen::legalMoves(pos, moves);
     if (depth == 1)
         return moves.size;
     UndoInfo ui;
@@ -27,6 +27,8 @@
 
 const int History::maxSum;
 const int History::maxVal;
+const int History::nContexts;
+const int History::nCaptTypes;
 
 int History::depthTable[] = {
     0, 1, 6, 19, 42, 56
@@ -40,6 +42,13 @@ History::init() {
             ht[p][sq].scaledScore = 0;
         }
     }
+    contHist.assign(nContexts * nContexts, HTEntry{0, 0});
+    for (int i = 0; i < nContexts; i++)
+        counterMoves[i] = 0;
+    for (int p = 0; p < Piece::nPieceTypes; p++)
+        for (int sq = 0; sq < 64; sq++)
+            for (int c = 0; c < nCaptTypes; c++)
+                captHist[p][sq][c] = HTEntry{0, 0};
 }
 
 void
@@ -47,6 +56,12 @@ History::reScale() {
     for (int p = 0; p < Piece::nPieceTypes; p++)
         for (Square sq : AllSquares())
             ht[p][sq].nValues >>= 2;
+    for (HTEntry& e : contHist)
+        e.nValues >>= 2;
+    for (int p = 0; p < Piece::nPieceTypes; p++)
+        for (int sq = 0; sq < 64; sq++)
+            for (int c = 0; c < nCaptTypes; c++)
+                captHist[p][sq][c].nValues >>= 2;
 }
 
 void
@@ -29,8 +29,14 @@
 #include "piece.hpp"
 #include "position.hpp"
 
+#include <vector>
+
 /**
- * Implements the relative history heuristic.
+ * Implements the relative history heuristic. In addition to the piece/to-square
+ * history, continuation history indexed by the previous one or two moves and
+ * a counter move table indexed by the previous move are maintained.
+ * Captures use a separate capture history, indexed by moving piece,
+ * to-square and captured piece type.
  */
 class History {
 public:
@@ -42,14 +48,39 @@ public:
     /** Rescale the history counters, so that future updates have more weight. */
     void reScale();
 
-    /** Record move as a success. */
-    void addSuccess(const Position& pos, const Move& m, int depth);
+    /** Get the continuation context for a move that has already been made in pos,
+     *  defined by the moved piece and its destination square.
+     *  Returns -1 if prevMove is a null move or a "no move" marker. */
+    static int getContext(const Position& pos, const Move& prevMove);
+
+    /** Record move as a success. prev1 and prev2 are the contexts of the last
+     *  and second to last moves, or -1 if not known. */
+    void addSuccess(const Position& pos, const Move& m, int depth,
+                    int prev1 = -1, int prev2 = -1);
 
     /** Record move as a failure. */
-    void addFail(const Position& pos, const Move& m, int depth);
+    void addFail(const Position& pos, const Move& m, int depth,
+                 int prev1 = -1, int prev2 = -1);
+
+    /** Get a score between 0 and 49, depending of the success/fail ratio of the move.
+     *  If prev1 or prev2 is given, the continuation history is also used. */
+    int getHistScore(const Position& pos, const Move& m,
+                     int prev1 = -1, int prev2 = -1) const;
+
+    /** Set the move that refuted the last move, given by context prev1. */
+    void setCounterMove(int prev1, const Move& m);
+
+    /** Return true if m is the counter move for the last move context prev1. */
+    bool isCounterMove(int prev1, const Move& m) const;
+
+    /** Record capture m as a success. Quiescence search nodes count as depth 1. */
+    void addCaptureSuccess(const Position& pos, const Move& m, int depth);
 
-    /** Get a score between 0 and 49, depending of the success/fail ratio of the move. */
-    int getHistScore(const Position& pos, const Move& m) const;
+    /** Record capture m as a failure. */
+    void addCaptureFail(const Position& pos, const Move& m, int depth);
+
+    /** Get a score between 0 and 49, depending of the success/fail ratio of the capture. */
+    int getCaptureHistScore(const Position& pos, const Move& m) const;
 
     /** Print all history tables. */
     void print() const;
@@ -57,6 +88,12 @@ public:
 private:
     static int depthWeight(int depth);
 
+    static const int nContexts = Piece::nPieceTypes * 64;
+    static const int nCaptTypes = Piece::WPAWN + 1; // Uncolored captured piece, or EMPTY
+
+    /** Captured piece type index for the capture history table. */
+    static int captType(const Position& pos, const Move& m);
+
     static int depthTable[6];
 
     static const int log2Scale = 10;
@@ -69,6 +106,20 @@ private:
         U16 scaledScore; // histScore * scale
     };
     SqTbl<HTEntry> ht[Piece::nPieceTypes];
+
+    /** Continuation history, indexed by [prevContext * nContexts + context].
+     *  Heap allocated, because History objects are often stack allocated. */
+    std::vector<HTEntry> contHist;
+
+    U16 counterMoves[nContexts]; // Compressed moves, indexed by context
+
+    HTEntry captHist[Piece::nPieceTypes][64][nCaptTypes];
+
+    static void addSuccess(HTEntry& e, int cnt);
+    static void addFail(HTEntry& e, int cnt);
+
+    /** Get score from continuation history, or histScore if no information. */
+    int getContScore(int prev, int ctx, int histScore) const;
 };
 
 
@@ -82,40 +133,119 @@ History::depthWeight(int depth) {
     return depthTable[clamp(depth, 0, (int)COUNT_OF(depthTable)-1)];
 }
 
+inline int
+History::getContext(const Position& pos, const Move& prevMove) {
+    if (prevMove.from() == prevMove.to())
+        return -1;
+    return pos.getPiece(prevMove.to()) * 64 + prevMove.to().asInt();
+}
+
+inline void
+History::addSuccess(HTEntry& e, int cnt) {
+    int fpHistVal = e.scaledScore;
+    int sum = e.nValues;
+    fpHistVal = (fpHistVal * sum + (maxVal * scale - 1) * cnt) / (sum + cnt);
+    sum = std::min(sum + cnt, maxSum);
+    e.nValues = sum;
+    e.scaledScore = fpHistVal;
+}
+
+inline void
+History::addFail(HTEntry& e, int cnt) {
+    int fpHistVal = e.scaledScore;
+    int sum = e.nValues;
+    fpHistVal = fpHistVal * sum / (sum + cnt);
+    sum = std::min(sum + cnt, maxSum);
+    e.nValues = sum;
+    e.scaledScore = fpHistVal;
+}
+
 inline void
-History::addSuccess(const Position& pos, const Move& m, int depth) {
+History::addSuccess(const Position& pos, const Move& m, int depth, int prev1, int prev2) {
     int cnt = depthWeight(depth);
     if (cnt != 0) {
         int p = pos.getPiece(m.from());
-        HTEntry& e = ht[p][m.to()];
-        int fpHistVal = e.scaledScore;
-        int sum = e.nValues;
-        fpHistVal = (fpHistVal * sum + (maxVal * scale - 1) * cnt) / (sum + cnt);
-        sum = std::min(sum + cnt, maxSum);
-        e.nValues = sum;
-        e.scaledScore = fpHistVal;
+        addSuccess(ht[p][m.to()], cnt);
+        int ctx = p * 64 + m.to().asInt();
+        if (prev1 >= 0)
+            addSuccess(contHist[prev1 * nContexts + ctx], cnt);
+        if (prev2 >= 0)
+            addSuccess(contHist[prev2 * nContexts + ctx], cnt);
     }
 }
 
 inline void
-History::addFail(const Position& pos, const Move& m, int depth) {
+History::addFail(const Position& pos, const Move& m, int depth, int prev1, int prev2) {
     int cnt = depthWeight(depth);
     if (cnt != 0) {
         int p = pos.getPiece(m.from());
-        HTEntry& e = ht[p][m.to()];
-        int fpHistVal = e.scaledScore;
-        int sum = e.nValues;
-        fpHistVal = fpHistVal * sum / (sum + cnt);
-        sum = std::min(sum + cnt, maxSum);
-        e.nValues = sum;
-        e.scaledScore = fpHistVal;
+        addFail(ht[p][m.to()], cnt);
+        int ctx = p * 64 + m.to().asInt();
+        if (prev1 >= 0)
+            addFail(contHist[prev1 * nContexts + ctx], cnt);
+        if (prev2 >= 0)
+            addFail(contHist[prev2 * nContexts + ctx], cnt);
+    }
+}
+
+inline int
+History::getContScore(int prev, int ctx, int histScore) const {
+    if (prev < 0)
+        return histScore;
+    const HTEntry& e = contHist[prev * nContexts + ctx];
+    if (e.nValues == 0)
+        return histScore;
+    return e.scaledScore >> log2Scale;
+}
+
+inline int
+History::getHistScore(const Position& pos, const Move& m, int prev1, int prev2) const {
+    int p = pos.getPiece(m.from());
+    int hs = ht[p][m.to()].scaledScore >> log2Scale;
+    if ((prev1 < 0) && (prev2 < 0))
+        return hs;
+    int ctx = p * 64 + m.to().asInt();
+    return (2 * hs + getContScore(prev1, ctx, hs) + getContScore(prev2, ctx, hs)) / 4;
+}
+
+inline int
+History::captType(const Position& pos, const Move& m) {
+    int captured = pos.getPiece(m.to());
+    if ((captured == Piece::EMPTY) && (m.to() == pos.getEpSquare())) {
+        int p = pos.getPiece(m.from());
+        if ((p == Piece::WPAWN) || (p == Piece::BPAWN))
+            return Piece::WPAWN; // En passant
     }
+    return Piece::makeWhite(captured);
+}
+
+inline void
+History::addCaptureSuccess(const Position& pos, const Move& m, int depth) {
+    int p = pos.getPiece(m.from());
+    addSuccess(captHist[p][m.to().asInt()][captType(pos, m)], depthWeight(std::max(depth, 1)));
+}
+
+inline void
+History::addCaptureFail(const Position& pos, const Move& m, int depth) {
+    int p = pos.getPiece(m.from());
+    addFail(captHist[p][m.to().asInt()][captType(pos, m)], depthWeight(std::max(depth, 1)));
 }
 
 inline int
-History::getHistScore(const Position& pos, const Move& m) const {
+History::getCaptureHistScore(const Position& pos, const Move& m) const {
     int p = pos.getPiece(m.from());
-    return ht[p][m.to()].scaledScore >> log2Scale;
+    return captHist[p][m.to().asInt()][captType(pos, m)].scaledScore >> log2Scale;
+}
+
+inline void
+History::setCounterMove(int prev1, const Move& m) {
+    if (prev1 >= 0)
+        counterMoves[prev1] = m.getCompressedMove();
+}
+
+inline bool
+History::isCounterMove(int prev1, const Move& m) const {
+    return (prev1 >= 0) && (counterMoves[prev1] == m.getCompressedMove());
 }
 
 #endif /* HISTORY_HPP_ */
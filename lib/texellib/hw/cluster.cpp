@@ -29,6 +29,7 @@
 #include "logger.hpp"
 #include <thread>
 #include <iostream>
+#include <cstdlib>
 
 
 Cluster&
@@ -52,6 +53,51 @@ Cluster::createLocalTTReceiver(TranspositionTable& tt) {
 Cluster::Cluster() {
 }
 
+#ifdef CLUSTER_SOCKETS
+void
+Cluster::init(int* argc, char*** argv) {
+    const char* nodeFile = getenv("TEXEL_CLUSTER_NODES");
+    const char* rankStr = getenv("TEXEL_CLUSTER_RANK");
+    if (!nodeFile || !rankStr)
+        return;
+    int r;
+    if (!str2Num(std::string(rankStr), r) || !transport.readConfig(nodeFile, r))
+        return;
+
+    rank = r;
+    size = transport.getNumberOfNodes();
+    computeNeighbors();
+    if (!transport.connect(parent, children)) {
+        std::cerr << "Cluster node " << rank << ": cannot connect to neighbor nodes" << std::endl;
+        transport.close();
+        exit(1);
+    }
+    computeConcurrency();
+}
+
+void
+Cluster::finalize() {
+    transport.close();
+}
+
+void
+Cluster::sendInts(int peer, const std::vector<int>& data) {
+    std::vector<U8> buf;
+    for (int d : data)
+        for (int i = 0; i < 4; i++)
+            buf.push_back((U8)(d >> (8 * i)));
+    transport.sendBlocking(peer, buf.data(), buf.size());
+}
+
+void
+Cluster::recvInts(int peer, std::vector<int>& data) {
+    std::vector<U8> buf(SearchConst::MAX_CLUSTER_BUF_SIZE);
+    int len = transport.recvBlocking(peer, buf.data(), buf.size());
+    data.clear();
+    for (int i = 0; i + 4 <= len; i += 4)
+        data.push_back(buf[i] | (buf[i+1] << 8) | (buf[i+2] << 16) | (buf[i+3] << 24));
+}
+#else
 void
 Cluster::init(int* argc, char*** argv) {
     int provided;
@@ -71,6 +117,22 @@ Cluster::finalize() {
     MPI_Finalize();
 }
 
+void
+Cluster::sendInts(int peer, const std::vector<int>& data) {
+    MPI_Send(const_cast<int*>(&data[0]), data.size(), MPI_INT, peer, 0, MPI_COMM_WORLD);
+}
+
+void
+Cluster::recvInts(int peer, std::vector<int>& data) {
+    MPI_Status status;
+    MPI_Probe(peer, 0, MPI_COMM_WORLD, &status);
+    int count;
+    MPI_Get_count(&status, MPI_INT, &count);
+    data.resize(count);
+    MPI_Recv(&data[0], count, MPI_INT, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+#endif
+
 void
 Cluster::computeNeighbors() {
     const int maxChildren = 4;
@@ -91,14 +153,10 @@ Cluster::computeConcurrency() {
     const int nChild = children.size();
     int nChildLevels = 0;
     for (int c = 0; c < nChild; c++) {
-        MPI_Status status;
-        MPI_Probe(children[c], 0, MPI_COMM_WORLD, &status);
-        int count;
-        MPI_Get_count(&status, MPI_INT, &count);
-        std::vector<int> buf(count);
-        MPI_Recv(&buf[0], count, MPI_INT, children[c], 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        std::vector<int> buf;
+        recvInts(children[c], buf);
         std::vector<Concurrency> childConcur;
-        int nLev = count / 2;
+        int nLev = buf.size() / 2;
         for (int i = 0; i < nLev; i++)
             childConcur.emplace_back(buf[2*i], buf[2*i+1]);
         childConcurrency.push_back(std::move(childConcur));
@@ -120,7 +178,7 @@ Cluster::computeConcurrency() {
             buf[2*lev+2] = nc;
             buf[2*lev+3] = nt;
         }
-        MPI_Send(&buf[0], count, MPI_INT, parent, 0, MPI_COMM_WORLD);
+        sendInts(parent, buf);
     }
     if (getNodeNumber() == 0) {
         int nc = thisConcurrency.cores;
@@ -145,7 +203,7 @@ Communicator*
 Cluster::createParentCommunicator(TranspositionTable& tt) {
     if (getParentNode() == -1)
         return nullptr;
-    clusterParent = make_unique<MPICommunicator>(nullptr, tt, getNodeNumber(), getParentNode(), -1);
+    clusterParent = make_unique<ClusterCommunicator>(nullptr, tt, getNodeNumber(), getParentNode(), -1);
     return clusterParent.get();
 }
 
@@ -155,7 +213,7 @@ Cluster::createChildCommunicators(Communicator* mainThreadComm, TranspositionTab
     int n = childRanks.size();
     for (int i = 0; i < n; i++) {
         int peerRank = childRanks[i];
-        auto comm = make_unique<MPICommunicator>(mainThreadComm, tt, getNodeNumber(), peerRank, i);
+        auto comm = make_unique<ClusterCommunicator>(mainThreadComm, tt, getNodeNumber(), peerRank, i);
         clusterChildren.push_back(std::move(comm));
     }
 }
@@ -269,35 +327,35 @@ Cluster::assignThreads(int numThreads, int& threadsThisNode, std::vector<int>& t
 
 // ----------------------------------------------------------------------------
 
-MPICommunicator::MPICommunicator(Communicator* parent, TranspositionTable& tt,
-                                 int myRank, int peerRank, int childNo)
+ClusterCommunicator::ClusterCommunicator(Communicator* parent, TranspositionTable& tt,
+                                         int myRank, int peerRank, int childNo)
     : Communicator(parent, tt), myRank(myRank), peerRank(peerRank), childNo(childNo),
-      ttReceiver(make_unique<ClusterTTReceiver>(CommandType::TT_DATA, peerRank, getCTT())) {
+      ttReceiver(make_unique<ClusterTTReceiver>(CommandType::TT_DATA, getCTT())) {
 }
 
 TTReceiver*
-MPICommunicator::getTTReceiver() {
+ClusterCommunicator::getTTReceiver() {
     return ttReceiver.get();
 }
 
 void
-MPICommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
+ClusterCommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
     ttReceiver->setDisabled(nThreads == 0);
     cmdQueue.push_back(std::make_shared<AssignThreadsCommand>(nThreads, firstThreadNo));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendInitSearch(const Position& pos,
+ClusterCommunicator::doSendInitSearch(const Position& pos,
                                   const std::vector<U64>& posHashList, int posHashListSize,
                                   bool clearHistory, int whiteContempt) {
     cmdQueue.push_back(std::make_shared<InitSearchCommand>(pos, posHashList, posHashListSize,
                                                            clearHistory, whiteContempt));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
+ClusterCommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
                                    int alpha, int beta, int depth) {
     cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
                                   [](const std::shared_ptr<Command>& cmd) {
@@ -307,11 +365,11 @@ MPICommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
                                   }),
                    cmdQueue.end());
     cmdQueue.push_back(std::make_shared<StartSearchCommand>(jobId, sti, alpha, beta, depth));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendStopSearch() {
+ClusterCommunicator::doSendStopSearch() {
     cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
                                   [](const std::shared_ptr<Command>& cmd) {
                                       return cmd->type == CommandType::START_SEARCH ||
@@ -320,32 +378,32 @@ MPICommunicator::doSendStopSearch() {
                                   }),
                    cmdQueue.end());
     cmdQueue.push_back(std::make_shared<Command>(CommandType::STOP_SEARCH));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendSetParam(const std::string& name, const std::string& value) {
+ClusterCommunicator::doSendSetParam(const std::string& name, const std::string& value) {
     int s = name.length() + value.length() + 2 * sizeof(int);
     if (s + sizeof(Communicator::Command) < SearchConst::MAX_CLUSTER_BUF_SIZE) {
         cmdQueue.push_back(std::make_shared<SetParamCommand>(name, value));
-        mpiSend();
+        clusterSend();
     }
 }
 
 void
-MPICommunicator::doSendQuit() {
+ClusterCommunicator::doSendQuit() {
     cmdQueue.push_back(std::make_shared<Command>(CommandType::QUIT));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendReportResult(int jobId, int score) {
+ClusterCommunicator::doSendReportResult(int jobId, int score) {
     cmdQueue.push_back(std::make_shared<Command>(CommandType::REPORT_RESULT, jobId, score));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
+ClusterCommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
     bool done = false;
     for (std::shared_ptr<Command>& c : cmdQueue) {
         if (c->type == CommandType::REPORT_STATS) {
@@ -358,33 +416,31 @@ MPICommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
     }
     if (!done)
         cmdQueue.push_back(std::make_shared<ReportStatsCommand>(nodesSearched, tbHits));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::retrieveStats(S64& nodesSearched, S64& tbHits) {
+ClusterCommunicator::retrieveStats(S64& nodesSearched, S64& tbHits) {
     assert(false); // Not used
 }
 
 void
-MPICommunicator::doSendStopAck() {
+ClusterCommunicator::doSendStopAck() {
     cmdQueue.push_back(std::make_shared<Command>(CommandType::STOP_ACK));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::doSendQuitAck() {
+ClusterCommunicator::doSendQuitAck() {
     cmdQueue.push_back(std::make_shared<Command>(CommandType::QUIT_ACK));
-    mpiSend();
+    clusterSend();
 }
 
 void
-MPICommunicator::mpiSend() {
+ClusterCommunicator::clusterSend() {
     for (int loop = 0; loop < 100; loop++) {
         if (sendBusy) {
-            int flag;
-            MPI_Test(&sendReq, &flag, MPI_STATUS_IGNORE);
-            if (!flag)
+            if (!sendDone())
                 break;
             sendBusy = false;
         }
@@ -394,33 +450,35 @@ MPICommunicator::mpiSend() {
         cmdQueue.pop_front();
         U8* buf = cmd->toByteBuf(&sendBuf[0]);
         int count = (int)(buf - &sendBuf[0]);
-        MPI_Isend(&sendBuf[0], count, MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &sendReq);
+        startSend(&sendBuf[0], count);
         sendBusy = true;
     }
 
     if (!sendBusy) {
-        if (ttReceiver->sendBuffer(sendReq))
+        const U8* data;
+        int count;
+        if (ttReceiver->getSendBuffer(data, count)) {
+            startSend(data, count);
             sendBusy = true;
+        }
     }
 }
 
 void
-MPICommunicator::doPoll(int pass) {
+ClusterCommunicator::doPoll(int pass) {
     if (pass == 0)
-        mpiRecv();
+        clusterRecv();
     if (pass == 1)
-        mpiSend();
+        clusterSend();
 }
 
 void
-MPICommunicator::mpiRecv() {
+ClusterCommunicator::clusterRecv() {
     int nTTReceives = 0;
     for (int loop = 0; loop < 100; loop++) {
         if (recvBusy) {
-            int flag;
-            MPI_Status status;
-            MPI_Test(&recvReq, &flag, &status);
-            if (flag) {
+            int recvCount;
+            if (recvDone(recvCount)) {
                 std::unique_ptr<Command> cmd = Command::createFromByteBuf(&recvBuf[0]);
                 switch (cmd->type) {
                 case CommandType::ASSIGN_THREADS: {
@@ -469,9 +527,7 @@ MPICommunicator::mpiRecv() {
                     break;
                 }
                 case CommandType::TT_DATA: {
-                    int count;
-                    MPI_Get_count(&status, MPI_BYTE, &count);
-                    ttReceiver->receiveBuffer(&recvBuf[0], count);
+                    ttReceiver->receiveBuffer(&recvBuf[0], recvCount);
                     nTTReceives++;
                     break;
                 }
@@ -480,13 +536,18 @@ MPICommunicator::mpiRecv() {
                     break;
                 }
                 recvBusy = false;
+            } else if (peerLost()) {
+                // Acknowledgements from the peer can never arrive, so
+                // waiting for them would hang the engine
+                std::cerr << "Cluster node " << myRank << ": lost connection to node "
+                          << peerRank << std::endl;
+                std::_Exit(1);
             }
         }
         if (recvBusy || quitFlag)
             break;
         if (!recvBusy) {
-            MPI_Irecv(&recvBuf[0], SearchConst::MAX_CLUSTER_BUF_SIZE,
-                      MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &recvReq);
+            startRecv();
             recvBusy = true;
         }
     }
@@ -494,8 +555,68 @@ MPICommunicator::mpiRecv() {
         cmdQueue.push_back(std::make_shared<Command>(CommandType::TT_ACK, -1, nTTReceives));
 }
 
+#ifdef CLUSTER_SOCKETS
+void
+ClusterCommunicator::startSend(const U8* data, int count) {
+    Cluster::instance().getTransport().send(peerRank, data, count);
+}
+
+bool
+ClusterCommunicator::sendDone() {
+    return Cluster::instance().getTransport().flush(peerRank);
+}
+
+void
+ClusterCommunicator::startRecv() {
+}
+
+bool
+ClusterCommunicator::recvDone(int& count) {
+    return Cluster::instance().getTransport().recv(peerRank, &recvBuf[0],
+                                                   SearchConst::MAX_CLUSTER_BUF_SIZE, count);
+}
+
+bool
+ClusterCommunicator::peerLost() {
+    return !Cluster::instance().getTransport().isConnected(peerRank);
+}
+#else
+void
+ClusterCommunicator::startSend(const U8* data, int count) {
+    MPI_Isend(const_cast<U8*>(data), count, MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &sendReq);
+}
+
+bool
+ClusterCommunicator::sendDone() {
+    int flag;
+    MPI_Test(&sendReq, &flag, MPI_STATUS_IGNORE);
+    return flag;
+}
+
+void
+ClusterCommunicator::startRecv() {
+    MPI_Irecv(&recvBuf[0], SearchConst::MAX_CLUSTER_BUF_SIZE,
+              MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &recvReq);
+}
+
+bool
+ClusterCommunicator::recvDone(int& count) {
+    int flag;
+    MPI_Status status;
+    MPI_Test(&recvReq, &flag, &status);
+    if (flag)
+        MPI_Get_count(&status, MPI_BYTE, &count);
+    return flag;
+}
+
+bool
+ClusterCommunicator::peerLost() {
+    return false;
+}
+#endif
+
 void
-MPICommunicator::notifyThread() {
+ClusterCommunicator::notifyThread() {
 }
 
 #endif // CLUSTER
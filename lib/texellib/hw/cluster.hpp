@@ -28,8 +28,12 @@
 
 #include "parallel.hpp"
 #ifdef CLUSTER
+#ifdef CLUSTER_SOCKETS
+#include "socketTransport.hpp"
+#else
 #include <mpi.h>
 #endif
+#endif
 
 #include <vector>
 
@@ -80,6 +84,11 @@ public:
     /** Return callers node number within the cluster. */
     int getNodeNumber() const;
 
+#ifdef CLUSTER_SOCKETS
+    /** Get the socket transport used to communicate with neighbor nodes. */
+    SocketTransport& getTransport();
+#endif
+
 private:
     Cluster();
 
@@ -98,6 +107,12 @@ private:
     /** Compute number of cores/threads for this node and all child nodes. */
     void computeConcurrency();
 
+    /** Send an integer vector to a neighbor node. Blocks until sent. */
+    void sendInts(int peer, const std::vector<int>& data);
+
+    /** Receive an integer vector from a neighbor node. Blocks until received. */
+    void recvInts(int peer, std::vector<int>& data);
+
     struct Concurrency {
         Concurrency(int c = 1, int t = 1) : cores(c), threads(t) {}
         int cores;    // Number of available cores
@@ -120,12 +135,18 @@ private:
 
     Concurrency thisConcurrency;
     std::vector<std::vector<Concurrency>> childConcurrency;  // [childNo][level]
+
+#ifdef CLUSTER_SOCKETS
+    SocketTransport transport;
+#endif
 };
 
-class MPICommunicator : public Communicator {
+/** Communicates with a neighboring cluster node, using either MPI or
+ *  the socket transport. */
+class ClusterCommunicator : public Communicator {
 public:
-    MPICommunicator(Communicator* parent, TranspositionTable& tt,
-                    int myRank, int peerRank, int childNo);
+    ClusterCommunicator(Communicator* parent, TranspositionTable& tt,
+                        int myRank, int peerRank, int childNo);
 
     TTReceiver* getTTReceiver() override;
 
@@ -147,24 +168,37 @@ public:
     void doSendStopAck() override;
     void doSendQuitAck() override;
 
-    void mpiSend();
+    void clusterSend();
 
     void doPoll(int pass) override;
 
     void notifyThread() override;
 
 private:
-    void mpiRecv();
+    void clusterRecv();
+
+    /** Start sending data to the peer node. */
+    void startSend(const U8* data, int count);
+    /** Return true if the last started send has completed. */
+    bool sendDone();
+    /** Start receiving data from the peer node into recvBuf. */
+    void startRecv();
+    /** Return true if a message has been received. Its size is stored in count. */
+    bool recvDone(int& count);
+    /** Return true if the connection to the peer node has been lost and
+     *  no more messages can be received from it. */
+    bool peerLost();
 
     const int myRank;
     const int peerRank;
     const int childNo;
 
     bool sendBusy = false;
-    MPI_Request sendReq;
-
     bool recvBusy = false;
+#ifndef CLUSTER_SOCKETS
+    MPI_Request sendReq;
     MPI_Request recvReq;
+#endif
 
     std::unique_ptr<ClusterTTReceiver> ttReceiver;
 
@@ -199,6 +233,13 @@ Cluster::getNodeNumber() const {
     return rank;
 }
 
+#ifdef CLUSTER_SOCKETS
+inline SocketTransport&
+Cluster::getTransport() {
+    return transport;
+}
+#endif
+
 inline int
 Cluster::getNumberOfNodes() const {
     return size;
@@ -215,7 +256,7 @@ Cluster::getChildNodes() const {
 }
 
 inline int
-MPICommunicator::clusterChildNo() const {
+ClusterCommunicator::clusterChildNo() const {
     return childNo;
 }
 
@@ -227,6 +268,7 @@ public:
     void finalize() {}
     bool isMasterNode() const { return true; }
     bool isEnabled() const { return false; }
+    int getNodeNumber() const { return 0; }
     std::unique_ptr<TTReceiver> createLocalTTReceiver(TranspositionTable& tt);
     Communicator* createParentCommunicator(TranspositionTable& tt) { return nullptr; }
     void createChildCommunicators(Communicator* mainThreadComm, TranspositionTable& tt) {}
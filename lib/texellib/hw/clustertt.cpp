@@ -33,7 +33,8 @@
 #ifdef CLUSTER
 
 ClusterTT::ClusterTT(TranspositionTable& tt)
-    : tt(tt), minDepth(Cluster::instance().isEnabled() ? 0 : INT_MAX) {
+    : tt(tt), stats(tt.newThreadStats()),
+      minDepth(Cluster::instance().isEnabled() ? 0 : INT_MAX) {
 }
 
 void
@@ -128,8 +129,8 @@ LocalTTReceiver::applyChunk(const ChangeBatch& changes) {
 
 // ----------------------------------------------------------------------------
 
-ClusterTTReceiver::ClusterTTReceiver(int cmdType, int peerRank, ClusterTT& ctt)
-    : cmdType(cmdType), peerRank(peerRank), ctt(ctt), currBuf(&buffer[0]) {
+ClusterTTReceiver::ClusterTTReceiver(int cmdType, ClusterTT& ctt)
+    : cmdType(cmdType), ctt(ctt), currBuf(&buffer[0]) {
     initBuf();
 }
 
@@ -165,7 +166,7 @@ ClusterTTReceiver::initBuf() {
 }
 
 bool
-ClusterTTReceiver::sendBuffer(MPI_Request& sendReq) {
+ClusterTTReceiver::getSendBuffer(const U8*& data, int& count) {
     if (nSendSlots <= 0)
         return false;
 
@@ -174,7 +175,7 @@ ClusterTTReceiver::sendBuffer(MPI_Request& sendReq) {
     currBuf = currBuf == &buffer[0] ? &buffer[1] : &buffer[0];
     initBuf();
 
-    int count = sendBuf->size;
+    count = sendBuf->size;
     if (count < SearchConst::MAX_CLUSTER_BUF_SIZE / 2) {
         if (minDepth > 0)
             minDepth--;
@@ -182,7 +183,7 @@ ClusterTTReceiver::sendBuffer(MPI_Request& sendReq) {
     if (count == sizeof(int))
         return false;
 
-    MPI_Isend(&sendBuf->data[0], count, MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &sendReq);
+    data = &sendBuf->data[0];
     nSendSlots--;
     return true;
 }
@@ -30,7 +30,6 @@
 
 #include <mutex>
 #ifdef CLUSTER
-#include <mpi.h>
 
 /** A receiver of transposition table changes. */
 class TTReceiver {
@@ -70,8 +69,12 @@ public:
     void insert(const TranspositionTable::TTEntry& ent);
     void flush();
 
+    /** Statistics for the thread using this object. */
+    TranspositionTable::Stats& getStats();
+
 private:
     TranspositionTable& tt;
+    std::shared_ptr<TranspositionTable::Stats> stats;
     int minDepth; // Smallest minDepth among all receivers
 
     void clusterInsert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore, bool busy);
@@ -99,7 +102,7 @@ private:
 /** Forwards transposition table changes to neighboring cluster node. */
 class ClusterTTReceiver : public TTReceiver {
 public:
-    ClusterTTReceiver(int cmdType, int peerRank, ClusterTT& ctt);
+    ClusterTTReceiver(int cmdType, ClusterTT& ctt);
 
     /** Set/clear disabled status. */
     void setDisabled(bool d);
@@ -107,9 +110,10 @@ public:
     /** Add a chunk of changes to the internal buffer. */
     int applyChunk(const ChangeBatch& changes) override;
 
-    /** Initiate a send request if there is any data to send.
-     *  @return True if a send request was initiated, false otherwise. */
-    bool sendBuffer(MPI_Request& sendReq);
+    /** Get the next buffer to send, if there is any data to send. The buffer
+     *  stays valid until the next call to this method.
+     *  @return True if there is data to send, false otherwise. */
+    bool getSendBuffer(const U8*& data, int& count);
 
     /** Process received data. */
     void receiveBuffer(const U8* buf, int len);
@@ -121,7 +125,6 @@ private:
     void initBuf();
 
     const int cmdType;
-    const int peerRank;
     ClusterTT& ctt;
 
     std::mutex mutex;
@@ -140,7 +143,7 @@ private:
 
 inline void
 ClusterTT::insert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore, bool busy) {
-    tt.insert(key, sm, type, ply, depth, evalScore, busy);
+    tt.insert(key, sm, type, ply, depth, evalScore, busy, stats.get());
     if (depth >= minDepth)
         clusterInsert(key, sm, type, ply, depth, evalScore, busy);
 }
@@ -164,7 +167,7 @@ ClusterTT::setWhiteContempt(int contempt) {
 
 inline void
 ClusterTT::probe(U64 key, TranspositionTable::TTEntry& result) {
-    tt.probe(key, result);
+    tt.probe(key, result, stats.get());
 }
 
 inline void
@@ -197,6 +200,11 @@ ClusterTT::getTT() const {
     return tt;
 }
 
+inline TranspositionTable::Stats&
+ClusterTT::getStats() {
+    return *stats;
+}
+
 inline void
 ClusterTTReceiver::setDisabled(bool d) {
     disabled = d;
@@ -209,18 +217,18 @@ public:
 };
 class ClusterTT {
 public:
-    explicit ClusterTT(TranspositionTable& tt) : tt(tt) {}
+    explicit ClusterTT(TranspositionTable& tt) : tt(tt), stats(tt.newThreadStats()) {}
     void setWhiteContempt(int contempt) {
         tt.setWhiteContempt(contempt);
     }
     void insert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore, bool busy = false) {
-        tt.insert(key, sm, type, ply, depth, evalScore, busy);
+        tt.insert(key, sm, type, ply, depth, evalScore, busy, stats.get());
     }
     void setBusy(const TranspositionTable::TTEntry& ent, int ply) {
         tt.setBusy(ent, ply);
     }
     void probe(U64 key, TranspositionTable::TTEntry& result) {
-        tt.probe(key, result);
+        tt.probe(key, result, stats.get());
     }
     void prefetch(U64 key) {
         tt.prefetch(key);
@@ -240,8 +248,12 @@ public:
     const TranspositionTable& getTT() const {
         return tt;
     }
+    TranspositionTable::Stats& getStats() {
+        return *stats;
+    }
 private:
     TranspositionTable& tt;
+    std::shared_ptr<TranspositionTable::Stats> stats;
 };
 #endif
 
@@ -61,6 +61,7 @@ Numa::Numa() {
     for (int n = 0; n < nodes; n++)
         for (int i = 0; i < cores / nodes; i++)
             threadToNode.push_back(n);
+    numCoreThreads = threadToNode.size();
     for (int t = 0; t < threads - cores; t++)
         threadToNode.push_back(t % nodes);
 #else
@@ -70,6 +71,7 @@ Numa::Numa() {
     for (const NodeInfo& ni : nodes)
         for (int i = 0; i < ni.numCores; i++)
             threadToNode.push_back(ni.node);
+    numCoreThreads = threadToNode.size();
 
     bool done = false;
     while (!done) {
@@ -269,6 +271,7 @@ Numa::getNodeInfoMap(int maxNode, std::map<int, NodeInfo>& nodeInfo) {
 void
 Numa::disable() {
     threadToNode.clear();
+    numCoreThreads = 0;
 }
 
 int
@@ -280,6 +283,15 @@ Numa::nodeForThread(int threadNo) const {
     return -1;
 }
 
+bool
+Numa::isSmtThread(int threadNo) const {
+#ifdef NUMA
+    if (threadNo < (int)threadToNode.size())
+        return threadNo >= numCoreThreads;
+#endif
+    return false;
+}
+
 void
 Numa::bindThread(int threadNo) const {
 #ifdef NUMA
@@ -47,12 +47,17 @@ public:
     /** Bind current thread to NUMA node determined by nodeForThread(). */
     void bindThread(int threadNo) const;
 
+    /** Preferred node for a given search thread, or -1 if the thread
+     *  should not be bound to any particular node. */
+    int nodeForThread(int threadNo) const;
+
+    /** Return true if a search thread is expected to run on a hardware thread
+     *  that shares a physical core with a lower numbered search thread. */
+    bool isSmtThread(int threadNo) const;
+
 private:
     Numa();
 
-    /** Preferred node for a given search thread. */
-    int nodeForThread(int threadNo) const;
-
     struct NodeInfo {
         int node = 0;
         int numCores = 0;
@@ -67,6 +72,10 @@ private:
 
     /** Thread number to node number. */
     std::vector<int> threadToNode;
+
+    /** Number of threads that run on separate physical cores. Threads with
+     *  higher numbers run on hyperthread siblings. */
+    int numCoreThreads = 0;
 };
 
 #endif /* NUMA_HPP_ */
@@ -37,28 +37,132 @@
 
 #include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
 
 
 void
 Notifier::notify() {
-    {
+    notified = true;
+    if (sleeping) {
         std::lock_guard<std::mutex> L(mutex);
-        notified = true;
+        cv.notify_all();
     }
-    cv.notify_all();
 }
 
 void
 Notifier::wait(int timeOutMs) {
+    int spinUs = UciParams::threadSpinWait->getIntPar();
+    if (timeOutMs >= 0)
+        spinUs = std::min(spinUs, timeOutMs * 1000);
+    if (spinUs > 0) {
+        auto t0 = std::chrono::steady_clock::now();
+        while (true) {
+            for (int i = 0; i < 64; i++) {
+                if (notified.exchange(false))
+                    return;
+                std::this_thread::yield();
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() >= spinUs)
+                break;
+        }
+    }
+
     std::unique_lock<std::mutex> L(mutex);
-    if (timeOutMs == -1) {
-        while (!notified)
+    sleeping = true;
+    auto isNotified = [this]() { return notified.exchange(false); };
+    if (timeOutMs == -1)
+        cv.wait(L, isNotified);
+    else
+        cv.wait_for(L, std::chrono::milliseconds(timeOutMs), isNotified);
+    sleeping = false;
+}
+
+// ----------------------------------------------------------------------------
+
+DeterministicScheduler&
+DeterministicScheduler::instance() {
+    static DeterministicScheduler sched;
+    return sched;
+}
+
+void
+DeterministicScheduler::activate(int nThreads) {
+    std::unique_lock<std::mutex> L(mutex);
+    this->nThreads = std::max(nThreads, 1);
+    turn = 0;
+    active = true;
+    for (int i = 1; i < this->nThreads && i < (int)notifiers.size(); i++)
+        if (notifiers[i])
+            notifiers[i]->notify();
+    // Threads still running from a previous search must not see commands
+    // sent after activation before they get their turn.
+    while (nWaiting < this->nThreads - 1)
+        cv.wait(L);
+}
+
+void
+DeterministicScheduler::deactivate() {
+    std::lock_guard<std::mutex> L(mutex);
+    if (!active)
+        return;
+    active = false;
+    cv.notify_all();
+    for (Notifier* n : notifiers)
+        if (n)
+            n->notify();
+}
+
+bool
+DeterministicScheduler::isActive() const {
+    return active;
+}
+
+void
+DeterministicScheduler::setNotifier(int threadNo, Notifier* notifier) {
+    std::lock_guard<std::mutex> L(mutex);
+    if (threadNo >= (int)notifiers.size())
+        notifiers.resize(threadNo + 1, nullptr);
+    notifiers[threadNo] = notifier;
+}
+
+bool
+DeterministicScheduler::waitTurn(int threadNo) {
+    if (!active)
+        return false;
+    std::unique_lock<std::mutex> L(mutex);
+    if (threadNo >= nThreads)
+        return false;
+    if (active && turn != threadNo) {
+        nWaiting++;
+        cv.notify_all();
+        while (active && turn != threadNo)
             cv.wait(L);
-    } else {
-        if (!notified)
-            cv.wait_for(L, std::chrono::milliseconds(timeOutMs));
+        nWaiting--;
     }
-    notified = false;
+    return active;
+}
+
+void
+DeterministicScheduler::passTurn(int threadNo) {
+    if (!active)
+        return;
+    std::lock_guard<std::mutex> L(mutex);
+    if (!active || turn != threadNo)
+        return;
+    turn = (turn + 1) % nThreads;
+    cv.notify_all();
+    if (turn < (int)notifiers.size() && notifiers[turn])
+        notifiers[turn]->notify();
+}
+
+void
+DeterministicScheduler::yield(int threadNo) {
+    if (!active)
+        return;
+    passTurn(threadNo);
+    waitTurn(threadNo);
 }
 
 // ----------------------------------------------------------------------------
@@ -161,7 +265,7 @@ Communicator::sendQuit() {
 void
 Communicator::sendReportResult(int jobId, int score) {
     if (parent)
-        parent->doSendReportResult(jobId, score);
+        sendToParent(REPORT_RESULT, jobId, score);
 }
 
 void
@@ -184,26 +288,43 @@ Communicator::sendStopAck(bool child) {
         stopAckWaitSelf = false;
     }
     if (hasStopAck() && parent)
-        parent->doSendStopAck();
+        sendToParent(STOP_ACK);
 }
 
 void
 Communicator::forwardStopAck() {
     if (parent)
-        parent->doSendStopAck();
+        sendToParent(STOP_ACK);
 }
 
 void
 Communicator::sendQuitAck() {
     quitAckWaitChildren--;
     if (parent && hasQuitAck())
-        parent->doSendQuitAck();
+        sendToParent(QUIT_ACK);
 }
 
 void
 Communicator::forwardQuitAck() {
     if (parent)
+        sendToParent(QUIT_ACK);
+}
+
+void
+Communicator::sendToParent(CommandType type, int jobId, int resultScore) {
+    switch (type) {
+    case REPORT_RESULT:
+        parent->doSendReportResult(jobId, resultScore);
+        break;
+    case STOP_ACK:
+        parent->doSendStopAck();
+        break;
+    case QUIT_ACK:
         parent->doSendQuitAck();
+        break;
+    default:
+        assert(false);
+    }
 }
 
 void
@@ -214,60 +335,67 @@ Communicator::poll(CommandHandler& handler) {
         for (auto& c : children)
             c->doPoll(pass);
     }
+    processCommands(handler);
+}
 
-    while (true) {
-        std::unique_lock<std::mutex> L(mutex);
-        if (cmdQueue.empty())
-            break;
-        std::shared_ptr<Command> cmd = cmdQueue.front();
-        cmdQueue.pop_front();
-        L.unlock();
-
-        switch (cmd->type) {
-        case CommandType::ASSIGN_THREADS: {
-            const AssignThreadsCommand* aCmd = static_cast<const AssignThreadsCommand*>(cmd.get());
-            handler.assignThreads(aCmd->nThreads, aCmd->firstThreadNo);
-            break;
-        }
-        case CommandType::INIT_SEARCH: {
-            const InitSearchCommand* iCmd = static_cast<const InitSearchCommand*>(cmd.get());
-            Position pos;
-            pos.deSerialize(iCmd->posData);
-            handler.initSearch(pos, iCmd->posHashList, iCmd->posHashListSize, iCmd->clearHistory,
-                               iCmd->whiteContempt);
-            break;
-        }
-        case CommandType::START_SEARCH: {
-            const StartSearchCommand*  sCmd = static_cast<const StartSearchCommand*>(cmd.get());
-            handler.startSearch(sCmd->jobId, sCmd->sti, sCmd->alpha, sCmd->beta, sCmd->depth);
-            break;
-        }
-        case CommandType::STOP_SEARCH:
-            handler.stopSearch();
-            break;
-        case CommandType::SET_PARAM: {
-            const SetParamCommand* spCmd = static_cast<const SetParamCommand*>(cmd.get());
-            handler.setParam(spCmd->name, spCmd->value);
-            break;
-        }
-        case CommandType::QUIT:
-            handler.quit();
-            break;
-        case CommandType::REPORT_RESULT:
-            handler.reportResult(cmd->jobId, cmd->resultScore);
-            break;
-        case CommandType::STOP_ACK:
-            handler.stopAck();
-            break;
-        case CommandType::QUIT_ACK:
-            handler.quitAck();
-            break;
-        case CommandType::REPORT_STATS:
-            break;
-        case CommandType::TT_DATA:
-        case CommandType::TT_ACK:
-            assert(false);
-        }
+void
+Communicator::dispatch(const Command& cmd, CommandHandler& handler) {
+    switch (cmd.type) {
+    case CommandType::ASSIGN_THREADS: {
+        const AssignThreadsCommand& aCmd = static_cast<const AssignThreadsCommand&>(cmd);
+        handler.assignThreads(aCmd.nThreads, aCmd.firstThreadNo);
+        break;
+    }
+    case CommandType::INIT_SEARCH: {
+        const InitSearchCommand& iCmd = static_cast<const InitSearchCommand&>(cmd);
+        Position pos;
+        pos.deSerialize(iCmd.posData);
+        handler.initSearch(pos, iCmd.posHashList, iCmd.posHashListSize, iCmd.clearHistory,
+                           iCmd.whiteContempt);
+        break;
+    }
+    case CommandType::SET_PARAM: {
+        const SetParamCommand& spCmd = static_cast<const SetParamCommand&>(cmd);
+        handler.setParam(spCmd.name, spCmd.value);
+        break;
+    }
+    default:
+        assert(false);
+    }
+}
+
+void
+Communicator::dispatch(const CommandRecord& rec, CommandHandler& handler) {
+    if (rec.cmd) {
+        dispatch(*rec.cmd, handler);
+        return;
+    }
+    switch (rec.type) {
+    case CommandType::START_SEARCH:
+        handler.startSearch(rec.jobId, rec.sti, rec.alpha, rec.beta, rec.depth);
+        break;
+    case CommandType::STOP_SEARCH:
+        handler.stopSearch();
+        break;
+    case CommandType::QUIT:
+        handler.quit();
+        break;
+    case CommandType::REPORT_RESULT:
+        handler.reportResult(rec.jobId, rec.resultScore);
+        break;
+    case CommandType::STOP_ACK:
+        handler.stopAck();
+        break;
+    case CommandType::QUIT_ACK:
+        handler.quitAck();
+        break;
+    case CommandType::ASSIGN_THREADS:
+    case CommandType::INIT_SEARCH:
+    case CommandType::SET_PARAM:
+    case CommandType::REPORT_STATS:
+    case CommandType::TT_DATA:
+    case CommandType::TT_ACK:
+        assert(false);
     }
 }
 
@@ -430,13 +558,29 @@ Communicator::Command::createFromByteBuf(const U8* buffer) {
 // ----------------------------------------------------------------------------
 
 ThreadCommunicator::ThreadCommunicator(Communicator* parent, TranspositionTable& tt,
-                                       Notifier& notifier, bool createTTReceiver)
-    : Communicator(parent, tt), notifier(&notifier) {
+                                       Notifier& notifier, bool createTTReceiver, int threadNo)
+    : Communicator(parent, tt), notifier(&notifier), threadNo(threadNo),
+      threadParent(dynamic_cast<ThreadCommunicator*>(parent)) {
     if (createTTReceiver)
         ttReceiver = Cluster::instance().createLocalTTReceiver(tt);
+    if (threadParent) {
+        std::lock_guard<std::mutex> L(threadParent->mutex);
+        auto& tc = threadParent->threadChildren;
+        auto it = std::upper_bound(tc.begin(), tc.end(), threadNo,
+                                   [](int tNo, const ThreadCommunicator* c) {
+                                       return tNo < c->threadNo;
+                                   });
+        tc.insert(it, this);
+    }
+    inBatch.reserve(64);
 }
 
 ThreadCommunicator::~ThreadCommunicator() {
+    if (threadParent) {
+        std::lock_guard<std::mutex> L(threadParent->mutex);
+        auto& tc = threadParent->threadChildren;
+        tc.erase(std::remove(tc.begin(), tc.end(), this), tc.end());
+    }
 }
 
 TTReceiver*
@@ -450,100 +594,95 @@ ThreadCommunicator::setNotifier(Notifier& notifier) {
 }
 
 void
-ThreadCommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<AssignThreadsCommand>(nThreads, firstThreadNo));
+ThreadCommunicator::putCommand(CommandRecord&& rec) {
+    inQueue.push(std::move(rec));
     notifier->notify();
 }
 
+void
+ThreadCommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
+    CommandRecord rec;
+    rec.cmd = std::make_shared<AssignThreadsCommand>(nThreads, firstThreadNo);
+    putCommand(std::move(rec));
+}
+
 void
 ThreadCommunicator::doSendInitSearch(const Position& pos,
                                      const std::vector<U64>& posHashList, int posHashListSize,
                                      bool clearHistory, int whiteContempt) {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<InitSearchCommand>(pos, posHashList, posHashListSize,
-                                                           clearHistory, whiteContempt));
-    notifier->notify();
+    CommandRecord rec;
+    rec.cmd = std::make_shared<InitSearchCommand>(pos, posHashList, posHashListSize,
+                                                  clearHistory, whiteContempt);
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
                                       int alpha, int beta, int depth) {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
-                                  [](const std::shared_ptr<Command>& cmd) {
-                                      return cmd->type == CommandType::START_SEARCH ||
-                                             cmd->type == CommandType::STOP_SEARCH ||
-                                             cmd->type == CommandType::REPORT_RESULT;
-                                  }),
-                   cmdQueue.end());
-    cmdQueue.push_back(std::make_shared<StartSearchCommand>(jobId, sti, alpha, beta, depth));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::START_SEARCH;
+    rec.jobId = jobId;
+    rec.sti = sti;
+    rec.alpha = alpha;
+    rec.beta = beta;
+    rec.depth = depth;
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendStopSearch() {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
-                                  [](const std::shared_ptr<Command>& cmd) {
-                                      return cmd->type == CommandType::START_SEARCH ||
-                                             cmd->type == CommandType::STOP_SEARCH ||
-                                             cmd->type == CommandType::REPORT_RESULT;
-                                  }),
-                   cmdQueue.end());
-    cmdQueue.push_back(std::make_shared<Command>(CommandType::STOP_SEARCH));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::STOP_SEARCH;
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendSetParam(const std::string& name, const std::string& value) {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<SetParamCommand>(name, value));
-    notifier->notify();
+    CommandRecord rec;
+    rec.cmd = std::make_shared<SetParamCommand>(name, value);
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendQuit() {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<Command>(CommandType::QUIT));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::QUIT;
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendReportResult(int jobId, int score) {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<Command>(CommandType::REPORT_RESULT, jobId, score));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::REPORT_RESULT;
+    rec.jobId = jobId;
+    rec.resultScore = score;
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
-    std::lock_guard<std::mutex> L(mutex);
     this->nodesSearched += nodesSearched;
     this->tbHits += tbHits;
 }
 
 void
 ThreadCommunicator::retrieveStats(S64& nodesSearched, S64& tbHits) {
-    std::lock_guard<std::mutex> L(mutex);
-    nodesSearched += this->nodesSearched;
-    tbHits += this->tbHits;
-    this->nodesSearched = 0;
-    this->tbHits = 0;
+    nodesSearched += this->nodesSearched.exchange(0);
+    tbHits += this->tbHits.exchange(0);
 }
 
 void
 ThreadCommunicator::doSendStopAck() {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<Command>(CommandType::STOP_ACK));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::STOP_ACK;
+    putCommand(std::move(rec));
 }
 
 void
 ThreadCommunicator::doSendQuitAck() {
-    std::lock_guard<std::mutex> L(mutex);
-    cmdQueue.push_back(std::make_shared<Command>(CommandType::QUIT_ACK));
-    notifier->notify();
+    CommandRecord rec;
+    rec.type = CommandType::QUIT_ACK;
+    putCommand(std::move(rec));
 }
 
 void
@@ -551,12 +690,98 @@ ThreadCommunicator::notifyThread() {
     notifier->notify();
 }
 
+void
+ThreadCommunicator::sendToParent(CommandType type, int jobId, int resultScore) {
+    if (!threadParent) {
+        Communicator::sendToParent(type, jobId, resultScore);
+        return;
+    }
+    CommandRecord rec;
+    rec.type = type;
+    rec.jobId = jobId;
+    rec.resultScore = resultScore;
+    upQueue.push(std::move(rec));
+    threadParent->notifyThread();
+}
+
+void
+ThreadCommunicator::processCommands(CommandHandler& handler) {
+    // A start or stop command makes all earlier start, stop and
+    // report result commands from the same sender obsolete.
+    CommandRecord rec;
+    while (inQueue.pop(rec))
+        inBatch.push_back(std::move(rec));
+    auto isJobCmd = [](CommandType type) {
+        return type == CommandType::START_SEARCH ||
+               type == CommandType::STOP_SEARCH ||
+               type == CommandType::REPORT_RESULT;
+    };
+    int lastStartStop = -1;
+    for (int i = inBatchPos; i < (int)inBatch.size(); i++) {
+        CommandType type = inBatch[i].type;
+        if (!inBatch[i].cmd && (type == CommandType::START_SEARCH || type == CommandType::STOP_SEARCH))
+            lastStartStop = i;
+    }
+    while (inBatchPos < (int)inBatch.size()) {
+        int idx = inBatchPos++;
+        const CommandRecord& r = inBatch[idx];
+        if (idx < lastStartStop && !r.cmd && isJobCmd(r.type))
+            continue;
+        dispatch(r, handler);
+    }
+    inBatch.clear();
+    inBatchPos = 0;
+
+    for (ThreadCommunicator* c : threadChildren)
+        while (c->upQueue.pop(rec))
+            dispatch(rec, handler);
+}
+
+void
+ThreadCommunicator::CommandChannel::push(CommandRecord&& rec) {
+    if (!overflowUsed && queue.push(std::move(rec)))
+        return;
+    std::lock_guard<std::mutex> L(overflowMutex);
+    overflow.push_back(std::move(rec));
+    overflowUsed = true;
+}
+
+bool
+ThreadCommunicator::CommandChannel::pop(CommandRecord& rec) {
+    if (queue.pop(rec))
+        return true;
+    if (!overflowUsed)
+        return false;
+    std::lock_guard<std::mutex> L(overflowMutex);
+    if (overflow.empty())
+        return false;
+    rec = std::move(overflow.front());
+    overflow.pop_front();
+    if (overflow.empty())
+        overflowUsed = false;
+    return true;
+}
+
 
 // ----------------------------------------------------------------------------
 
+/** Return the thread numbers first, first+1, ..., first+n-1. */
+static std::vector<int>
+threadRange(int first, int n) {
+    std::vector<int> ret;
+    for (int i = 0; i < n; i++)
+        ret.push_back(first + i);
+    return ret;
+}
+
 WorkerThread::WorkerThread(int threadNo, Communicator* parentComm,
                            int numWorkers, TranspositionTable& tt)
-    : threadNo(threadNo), numWorkers(numWorkers), terminate(false), tt(tt) {
+    : WorkerThread(threadNo, parentComm, threadRange(threadNo + 1, numWorkers - 1), tt) {
+}
+
+WorkerThread::WorkerThread(int threadNo, Communicator* parentComm,
+                           const std::vector<int>& childThreads, TranspositionTable& tt)
+    : threadNo(threadNo), childThreads(childThreads), terminate(false), tt(tt) {
     if (parentComm) {
         auto f = [this,parentComm]() {
             mainLoop(parentComm, false);
@@ -577,30 +802,91 @@ void
 WorkerThread::createWorkers(int firstThreadNo, Communicator* parentComm,
                             int numWorkers, TranspositionTable& tt,
                             std::vector<std::shared_ptr<WorkerThread>>& children) {
-    if (numWorkers <= 0) {
-        children.clear();
-        return;
-    }
+    createWorkers(threadRange(firstThreadNo, numWorkers), parentComm, tt, children);
+}
 
-    const int maxChildren = 4;
-    int numChildren = std::min(numWorkers, maxChildren);
+void
+WorkerThread::createWorkers(const std::vector<int>& threads, Communicator* parentComm,
+                            TranspositionTable& tt,
+                            std::vector<std::shared_ptr<WorkerThread>>& children) {
+    std::vector<std::vector<int>> subTrees;
+    getSubTrees(threads, subTrees);
+
+    int numChildren = subTrees.size();
     std::vector<int> newChildren;
     children.resize(numChildren);
     for (int i = 0; i < numChildren; i++) {
-        int n = (numWorkers + numChildren - i - 1) / (numChildren - i);
-        if (!children[i] || children[i]->getThreadNo() != firstThreadNo ||
-                children[i]->getNumWorkers() != n) {
-            children[i] = std::make_shared<WorkerThread>(firstThreadNo, parentComm, n, tt);
+        int childNo = subTrees[i][0];
+        std::vector<int> childThreads(subTrees[i].begin() + 1, subTrees[i].end());
+        if (!children[i] || children[i]->getThreadNo() != childNo ||
+                children[i]->childThreads != childThreads) {
+            children[i] = std::make_shared<WorkerThread>(childNo, parentComm, childThreads, tt);
             newChildren.push_back(i);
         }
-        firstThreadNo += n;
-        numWorkers -= n;
     }
 
     for (int i : newChildren)
         children[i]->waitInitialized();
 }
 
+void
+WorkerThread::getSubTrees(const std::vector<int>& threads,
+                          std::vector<std::vector<int>>& subTrees) {
+    const Numa& numa = Numa::instance();
+    getSubTrees(threads,
+                [&numa](int t) { return numa.nodeForThread(t); },
+                [&numa](int t) { return numa.isSmtThread(t); },
+                subTrees);
+}
+
+void
+WorkerThread::getSubTrees(const std::vector<int>& threads,
+                          const std::function<int(int)>& nodeForThread,
+                          const std::function<bool(int)>& isSmtThread,
+                          std::vector<std::vector<int>>& subTrees) {
+    subTrees.clear();
+    if (threads.empty())
+        return;
+
+    std::vector<int> nodes;
+    std::vector<std::vector<int>> nodeThreads;
+    for (int t : threads) {
+        int node = nodeForThread(t);
+        auto it = std::find(nodes.begin(), nodes.end(), node);
+        if (it == nodes.end()) {
+            nodes.push_back(node);
+            nodeThreads.emplace_back();
+            it = nodes.end() - 1;
+        }
+        nodeThreads[it - nodes.begin()].push_back(t);
+    }
+
+    if (nodeThreads.size() > 1) {
+        for (std::vector<int>& nt : nodeThreads) {
+            std::stable_partition(nt.begin(), nt.end(), [&isSmtThread](int t) {
+                return !isSmtThread(t);
+            });
+            subTrees.push_back(std::move(nt));
+        }
+        return;
+    }
+
+    std::vector<int> sorted(threads);
+    std::stable_partition(sorted.begin(), sorted.end(), [&isSmtThread](int t) {
+        return !isSmtThread(t);
+    });
+    const int maxChildren = 4;
+    int numWorkers = sorted.size();
+    int numChildren = std::min(numWorkers, maxChildren);
+    auto it = sorted.begin();
+    for (int i = 0; i < numChildren; i++) {
+        int n = (numWorkers + numChildren - i - 1) / (numChildren - i);
+        subTrees.emplace_back(it, it + n);
+        it += n;
+        numWorkers -= n;
+    }
+}
+
 void
 WorkerThread::waitInitialized() {
     initialized.wait();
@@ -615,29 +901,49 @@ WorkerThread::mainLoopCluster(std::unique_ptr<ThreadCommunicator>&& comm) {
 void
 WorkerThread::mainLoop(Communicator* parentComm, bool cluster) {
     Numa::instance().bindThread(threadNo);
+
+    // Allocate thread local tables after binding the thread, so that the
+    // memory is allocated on the NUMA node where the thread runs.
+    et = Evaluate::getEvalHashTables();
+    kt = make_unique<KillerTable>();
+    ht = make_unique<History>();
+
     if (!cluster) {
-        comm = make_unique<ThreadCommunicator>(parentComm, tt, threadNotifier, threadNo == 0);
+        comm = make_unique<ThreadCommunicator>(parentComm, tt, threadNotifier, threadNo == 0, threadNo);
         Cluster::instance().connectClusterReceivers(comm.get());
-        createWorkers(threadNo + 1, comm.get(), numWorkers - 1, tt, children);
+        createWorkers(childThreads, comm.get(), tt, children);
     } else
         comm->setNotifier(threadNotifier);
 
+    DeterministicScheduler& sched = DeterministicScheduler::instance();
+    sched.setNotifier(threadNo, &threadNotifier);
     initialized.notify();
 
     CommHandler handler(*this);
 
     while (true) {
-        bool handleClusterComm = Cluster::instance().isEnabled() && threadNo == 0;
-        threadNotifier.wait(handleClusterComm ? 1 : -1);
+        if (!sched.isActive()) {
+            bool handleClusterComm = Cluster::instance().isEnabled() && threadNo == 0;
+            threadNotifier.wait(handleClusterComm ? 1 : -1);
+        }
         if (terminate)
             break;
+        sched.waitTurn(threadNo);
         comm->poll(handler);
-        if (comm->hasQuitAck())
+        if (comm->hasQuitAck()) {
+            sched.passTurn(threadNo);
             break;
-        if (jobId != -1)
-            doSearch(handler);
+        }
+        if (jobId != -1) {
+            if (sti.currentMove.isEmpty())
+                doLazySearch(handler);
+            else
+                doSearch(handler);
+        }
         comm->sendStopAck(false);
+        sched.passTurn(threadNo);
     }
+    sched.setNotifier(threadNo, nullptr);
 }
 
 void
@@ -665,14 +971,11 @@ WorkerThread::CommHandler::initSearch(const Position& pos,
     wt.logFile = make_unique<TreeLogger>();
     wt.logFile->open("/home/petero/treelog.dmp", wt.threadNo);
     wt.rootNodeIdx = wt.logFile->logPosition(pos);
-    if (wt.kt)
-        wt.kt->clear();
-    if (wt.ht) {
-        if (clearHistory)
-            wt.ht->init();
-        else
-            wt.ht->reScale();
-    }
+    wt.kt->clear();
+    if (clearHistory)
+        wt.ht->init();
+    else
+        wt.ht->reScale();
 }
 
 void
@@ -772,6 +1075,7 @@ ThreadStopHandler::~ThreadStopHandler() {
 
 bool
 ThreadStopHandler::shouldStop() {
+    DeterministicScheduler::instance().yield(wt.getThreadNo());
     wt.poll(commHandler);
     if (wt.shouldStop(jobId))
         return true;
@@ -800,12 +1104,7 @@ ThreadStopHandler::reportNodes() {
 
 void
 WorkerThread::doSearch(CommHandler& commHandler) {
-    if (!et)
-        et = Evaluate::getEvalHashTables();
-    if (!kt)
-        kt = make_unique<KillerTable>();
-    if (!ht)
-        ht = make_unique<History>();
+    et->updateNetData();
 
     using namespace SearchConst;
     int initExtraDepth = 0;
@@ -848,3 +1147,83 @@ WorkerThread::doSearch(CommHandler& commHandler) {
         }
     }
 }
+
+void
+WorkerThread::doLazySearch(CommHandler& commHandler) {
+    et->updateNetData();
+
+    using namespace SearchConst;
+    std::vector<Move> rootMoves;
+    {
+        MoveList moves;
+        MoveGen::legalMoves(pos, moves);
+        for (int mi = 0; mi < moves.size; mi++)
+            rootMoves.push_back(moves[mi]);
+    }
+    if (rootMoves.empty()) {
+        jobId = -1;
+        return;
+    }
+    // Rotate the initial move order so that threads start in different subtrees
+    std::rotate(rootMoves.begin(), rootMoves.begin() + threadNo % rootMoves.size(),
+                rootMoves.end());
+
+    // Stagger the iterations so that threads search different depths at the same time
+    static const int skipSize[]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+    static const int skipPhase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+    const int skipIdx = (threadNo + 19) % 20;
+
+    const int maxDepth = std::min(depth, MAX_SEARCH_DEPTH);
+    for (int d = 1; d <= maxDepth; d++) {
+        if ((d < maxDepth) && ((d + skipPhase[skipIdx]) / skipSize[skipIdx]) % 2)
+            continue;
+        int alpha = -MATE0;
+        const int beta = MATE0;
+        for (int mi = 0; mi < (int)rootMoves.size(); mi++) {
+            Move& m = rootMoves[mi];
+            Search::SearchTables st(comm->getCTT(), *kt, *ht, *et);
+            Position pos(this->pos);
+
+            UndoInfo ui;
+            pos.makeMove(m, ui);
+
+            posHashList[posHashListSize++] = this->pos.zobristHash();
+            Search sc(pos, posHashList, posHashListSize, st, *comm, *logFile);
+            posHashListSize--;
+            sc.setThreadNo(threadNo);
+            sc.setWhiteContempt(whiteContempt);
+            sc.initSearchTreeInfo();
+            const int minProbeDepth = TBProbe::tbEnabled() ? UciParams::minProbeDepth->getIntPar() : MAX_SEARCH_DEPTH;
+            sc.setMinProbeDepth(minProbeDepth);
+
+            auto stopHandler = make_unique<ThreadStopHandler>(*this, jobId, sc, commHandler);
+            sc.setStopHandler(std::move(stopHandler));
+
+            const int ply = 1;
+            SearchTreeInfo rootSti;
+            rootSti.currentMove = m;
+            rootSti.currentMoveNo = mi;
+            sc.setSearchTreeInfo(ply-1, rootSti, rootNodeIdx);
+            bool inCheck = MoveGen::inCheck(pos);
+            try {
+                Square captSquare;
+                int score;
+                if (mi == 0) {
+                    score = -sc.negaScout(true, -beta, -alpha, ply, d - 1, captSquare, inCheck);
+                } else {
+                    score = -sc.negaScout(true, -(alpha+1), -alpha, ply, d - 1, captSquare, inCheck);
+                    if (score > alpha)
+                        score = -sc.negaScout(true, -beta, -alpha, ply, d - 1, captSquare, inCheck);
+                }
+                m.setScore(score);
+                alpha = std::max(alpha, score);
+            } catch (const Search::StopSearch&) {
+                return;
+            }
+        }
+        std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const Move& m1, const Move& m2) {
+            return m1.score() > m2.score();
+        });
+    }
+    jobId = -1;
+}
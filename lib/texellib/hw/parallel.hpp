@@ -32,12 +32,14 @@
 #include "timeUtil.hpp"
 
 #include <memory>
+#include <array>
 #include <vector>
 #include <deque>
 #include <set>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <atomic>
 
 
@@ -55,13 +57,86 @@ public:
 
     /** Wait until notify has been called at least once since the last call
      *  to this method. This method should only be called by one thread.
+     *  If the ThreadSpinWait UCI parameter is non-zero, the waiting thread first
+     *  spins for that many microseconds before blocking on a condition variable.
      *  @param timeOutMs Maximum amount of time to wait, or -1 to wait indefinitely */
     void wait(int timeOutMs = -1);
 
 private:
     std::mutex mutex;
     std::condition_variable cv;
-    bool notified = false;
+    std::atomic<bool> notified{false};
+    std::atomic<bool> sleeping{false}; // True if waiting thread may be blocked on cv
+};
+
+
+/** Serializes the execution of search threads to make multi-threaded searches
+ *  reproducible. When active, only the thread holding the turn is allowed to run.
+ *  Threads give up the turn at fixed node count intervals and the turn is passed
+ *  on in thread number order, so the interleaving of all threads only depends
+ *  on the number of searched nodes. */
+class DeterministicScheduler {
+public:
+    /** Get singleton instance. */
+    static DeterministicScheduler& instance();
+
+    /** Start scheduling threads 0 to nThreads-1. Thread 0 gets the first turn.
+     *  Must be called by thread 0. Returns when all other threads are waiting
+     *  for their turn. */
+    void activate(int nThreads);
+
+    /** Stop scheduling. All threads are allowed to run freely. */
+    void deactivate();
+
+    /** Return true if threads are currently being scheduled. */
+    bool isActive() const;
+
+    /** Set the notifier used to wake up a thread when it gets the turn. */
+    void setNotifier(int threadNo, Notifier* notifier);
+
+    /** Wait until threadNo gets the turn.
+     *  @return True if the thread holds the turn, false if not active. */
+    bool waitTurn(int threadNo);
+
+    /** Pass the turn to the next thread, if threadNo holds the turn. */
+    void passTurn(int threadNo);
+
+    /** Pass the turn to the next thread and wait until threadNo gets it back. */
+    void yield(int threadNo);
+
+private:
+    DeterministicScheduler() = default;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> active{false};
+    int nThreads = 1;
+    int turn = 0;
+    int nWaiting = 0; // Number of threads waiting in waitTurn()
+    std::vector<Notifier*> notifiers;
+};
+
+
+/** Lock-free queue with fixed capacity N, for one producer and one consumer thread. */
+template <typename T, int N>
+class SPSCQueue {
+public:
+    /** Insert an element at the end of the queue. Return false if the queue is full.
+     *  Must only be called by the producer thread. */
+    bool push(T&& e);
+
+    /** Remove the element at the front of the queue. Return false if the queue is empty.
+     *  Must only be called by the consumer thread. */
+    bool pop(T& e);
+
+private:
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+    std::atomic<U32> head{0}; // Index of next element to pop. Written by consumer.
+    char pad1[64 - sizeof(std::atomic<U32>)];
+    std::atomic<U32> tail{0}; // Index of next element to push. Written by producer.
+    char pad2[64 - sizeof(std::atomic<U32>)];
+    std::array<T, N> buf{};
 };
 
 
@@ -175,6 +250,9 @@ protected:
     /** Notify corresponding search thread that something has happened. */
     virtual void notifyThread() = 0;
 
+    /** Handle commands that have been sent to this communicator. */
+    virtual void processCommands(CommandHandler& handler) {}
+
     Communicator* getParent() { return parent; }
 
     enum CommandType {
@@ -272,6 +350,27 @@ protected:
         S64 nodesSearched = 0;
         S64 tbHits = 0;
     };
+    /** Fixed size command record. Commands containing variable size data are
+     *  stored in "cmd" instead. */
+    struct CommandRecord {
+        CommandType type { QUIT };
+        int jobId = -1;
+        int resultScore = 0;
+        int alpha = 0;
+        int beta = 0;
+        int depth = 0;
+        SearchTreeInfo sti;
+        std::shared_ptr<const Command> cmd;
+    };
+
+    /** Call the handler method corresponding to a command. */
+    static void dispatch(const Command& cmd, CommandHandler& handler);
+    static void dispatch(const CommandRecord& rec, CommandHandler& handler);
+
+    /** Send a REPORT_RESULT, STOP_ACK or QUIT_ACK command to the parent.
+     *  The default implementation calls the corresponding doSend method in the parent. */
+    virtual void sendToParent(CommandType type, int jobId = -1, int resultScore = 0);
+
     std::deque<std::shared_ptr<Command>> cmdQueue;
 
     std::mutex mutex;
@@ -290,11 +389,18 @@ private:
 };
 
 
-/** Handles communication between search threads within the same process. */
+/** Handles communication between search threads within the same process.
+ *  Commands are passed through lock-free single producer, single consumer
+ *  queues. Commands from the parent are stored in the child's inQueue, and
+ *  commands to the parent are stored in the child's upQueue. Commands sent to
+ *  a ThreadCommunicator from a cluster communicator are also stored in inQueue,
+ *  since cluster communicators are polled by the thread owning the ThreadCommunicator. */
 class ThreadCommunicator : public Communicator {
 public:
+    /** Constructor. threadNo is used to process commands from child
+     *  communicators in a reproducible order. */
     ThreadCommunicator(Communicator* parent, TranspositionTable& tt,
-                       Notifier& notifier, bool createTTReceiver);
+                       Notifier& notifier, bool createTTReceiver, int threadNo = 0);
     ~ThreadCommunicator();
 
     TTReceiver* getTTReceiver() override;
@@ -323,19 +429,55 @@ protected:
     void doPoll(int pass) override {}
     void notifyThread() override;
 
+    void processCommands(CommandHandler& handler) override;
+    void sendToParent(CommandType type, int jobId, int resultScore) override;
+
 private:
+    /** Single producer, single consumer command queue. If the lock-free queue
+     *  is full, commands are stored in a mutex protected overflow list instead,
+     *  so that the producer never has to wait for the consumer. */
+    class CommandChannel {
+    public:
+        void push(CommandRecord&& rec);
+        bool pop(CommandRecord& rec);
+    private:
+        SPSCQueue<CommandRecord, 256> queue;
+        std::atomic<bool> overflowUsed{false};
+        std::mutex overflowMutex;
+        std::deque<CommandRecord> overflow;
+    };
+
+    /** Store a command in inQueue and notify the thread. */
+    void putCommand(CommandRecord&& rec);
+
     Notifier* notifier;
     std::unique_ptr<TTReceiver> ttReceiver;
+
+    const int threadNo;
+    ThreadCommunicator* threadParent;               // Parent, if it is a ThreadCommunicator
+    std::vector<ThreadCommunicator*> threadChildren; // Children that are ThreadCommunicators, sorted by threadNo
+
+    CommandChannel inQueue; // Commands to this communicator
+    CommandChannel upQueue; // Commands from this communicator to threadParent
+
+    std::vector<CommandRecord> inBatch; // Commands removed from inQueue but not yet processed
+    int inBatchPos = 0;                 // Next command in inBatch to process
 };
 
 
 /** Handles communication between search threads. */
 class WorkerThread {
+    friend class ParallelTest;
 public:
     /** Constructor. */
     WorkerThread(int threadNo, Communicator* parentComm, int numWorkers,
                  TranspositionTable& tt);
 
+    /** Constructor. childThreads contains the thread numbers of all workers
+     *  in the tree rooted at this worker, excluding this worker. */
+    WorkerThread(int threadNo, Communicator* parentComm,
+                 const std::vector<int>& childThreads, TranspositionTable& tt);
+
     /** Destructor. Waits for thread to terminate. */
     ~WorkerThread();
 
@@ -345,7 +487,8 @@ public:
     /** Create numWorkers WorkerThread objects, arranged in a tree structure.
      *  parentComm is the Communicator corresponding to the already existing
      *  root node in that tree structure. The children to the root node are
-     *  returned in the "children" variable. */
+     *  returned in the "children" variable. The tree structure follows the
+     *  hardware topology, see getSubTrees(). */
     static void createWorkers(int firstThreadNo, Communicator* parentComm,
                               int numWorkers, TranspositionTable& tt,
                               std::vector<std::shared_ptr<WorkerThread>>& children);
@@ -375,6 +518,26 @@ public:
     void mainLoopCluster(std::unique_ptr<ThreadCommunicator>&& comm);
 
 private:
+    /** Create WorkerThread objects for the given thread numbers. */
+    static void createWorkers(const std::vector<int>& threads, Communicator* parentComm,
+                              TranspositionTable& tt,
+                              std::vector<std::shared_ptr<WorkerThread>>& children);
+
+    /** Split threads into subtrees, one subtree for each child of the current
+     *  worker. If threads belong to more than one NUMA node, there is one subtree
+     *  for each node. Otherwise threads running on separate physical cores come
+     *  first and threads running on hyperthread siblings are placed last.
+     *  The first thread in a subtree is the root of that subtree. */
+    static void getSubTrees(const std::vector<int>& threads,
+                            std::vector<std::vector<int>>& subTrees);
+
+    /** Like getSubTrees() above, but the hardware topology is given by the
+     *  nodeForThread and isSmtThread functions instead of by the Numa object. */
+    static void getSubTrees(const std::vector<int>& threads,
+                            const std::function<int(int)>& nodeForThread,
+                            const std::function<bool(int)>& isSmtThread,
+                            std::vector<std::vector<int>>& subTrees);
+
     /** Thread main loop. */
     void mainLoop(Communicator* parentComm, bool cluster);
 
@@ -400,6 +563,10 @@ private:
     /** Run a search for the current search parameters. */
     void doSearch(CommHandler& commHandler);
 
+    /** Run an independent iterative deepening search from the root position.
+     *  Used in lazy SMP mode, where only the transposition table is shared. */
+    void doLazySearch(CommHandler& commHandler);
+
 
     int threadNo;
     bool disabled = false; // True for not used cluster node
@@ -407,7 +574,7 @@ private:
     std::unique_ptr<std::thread> thread;
     Notifier threadNotifier;
     std::vector<std::shared_ptr<WorkerThread>> children;
-    const int numWorkers; // Number of worker threads including all child threads
+    const std::vector<int> childThreads; // Thread numbers of all threads in subtree, except this thread
 
     Notifier initialized;
     std::atomic<bool> terminate;
@@ -458,6 +625,28 @@ ThreadCommunicator::clusterChildNo() const {
     return -1;
 }
 
+template <typename T, int N>
+inline bool
+SPSCQueue<T,N>::push(T&& e) {
+    U32 t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= (U32)N)
+        return false;
+    buf[t & (N - 1)] = std::move(e);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, int N>
+inline bool
+SPSCQueue<T,N>::pop(T& e) {
+    U32 h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+        return false;
+    e = std::move(buf[h & (N - 1)]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
 inline int
 WorkerThread::getThreadNo() const {
     return threadNo;
@@ -465,7 +654,7 @@ WorkerThread::getThreadNo() const {
 
 inline int
 WorkerThread::getNumWorkers() const {
-    return numWorkers;
+    return 1 + childThreads.size();
 }
 
 inline bool
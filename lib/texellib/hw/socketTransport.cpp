@@ -0,0 +1,450 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * socketTransport.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#include "socketTransport.hpp"
+
+#ifdef CLUSTER_SOCKETS
+
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef MSG_NOSIGNAL
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+/** Max time to wait for other nodes to start. */
+static const int connectTimeoutMs = 120 * 1000;
+/** Max time for a connecting node to send its node number. */
+static const int handshakeTimeoutMs = 5 * 1000;
+
+static int
+elapsedMs(const std::chrono::steady_clock::time_point& t0) {
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+
+SocketTransport::~SocketTransport() {
+    close();
+}
+
+bool
+SocketTransport::readConfig(const std::string& fileName, int rank) {
+    std::ifstream is(fileName);
+    if (!is) {
+        std::cerr << "Cannot read cluster node file " << fileName << std::endl;
+        return false;
+    }
+    std::vector<std::string> addresses;
+    std::string line;
+    while (std::getline(is, line)) {
+        size_t idx = line.find('#');
+        if (idx != std::string::npos)
+            line = line.substr(0, idx);
+        line = trim(line);
+        if (!line.empty())
+            addresses.push_back(line);
+    }
+    return setNodes(addresses, rank);
+}
+
+bool
+SocketTransport::setNodes(const std::vector<std::string>& addresses, int rank) {
+    nodes.clear();
+    for (const std::string& s : addresses) {
+        Address addr;
+        if (!parseAddress(s, addr)) {
+            std::cerr << "Invalid cluster node address: " << s << std::endl;
+            nodes.clear();
+            return false;
+        }
+        nodes.push_back(addr);
+    }
+    if (rank < 0 || rank >= (int)nodes.size()) {
+        std::cerr << "Invalid cluster node number: " << rank << std::endl;
+        nodes.clear();
+        return false;
+    }
+    this->rank = rank;
+    peers.clear();
+    peers.resize(nodes.size());
+    return true;
+}
+
+bool
+SocketTransport::parseAddress(const std::string& str, Address& addr) {
+    if (startsWith(str, "unix:")) {
+        addr.unixSocket = true;
+        addr.port = str.substr(5);
+        return !addr.port.empty() && addr.port.length() < sizeof(sockaddr_un::sun_path);
+    }
+    size_t idx = str.rfind(':');
+    if (idx == std::string::npos || idx == 0 || idx + 1 == str.length())
+        return false;
+    addr.unixSocket = false;
+    addr.host = str.substr(0, idx);
+    addr.port = str.substr(idx + 1);
+    if (addr.host.length() >= 2 && addr.host[0] == '[' && addr.host.back() == ']')
+        addr.host = addr.host.substr(1, addr.host.length() - 2);
+    int port;
+    return str2Num(addr.port, port) && port > 0 && port < 65536;
+}
+
+bool
+SocketTransport::connect(int parent, const std::vector<int>& children) {
+    if (!children.empty() && !listen())
+        return false;
+
+    if (parent >= 0) {
+        int fd = connectTo(nodes[parent]);
+        if (fd < 0) {
+            std::cerr << "Cannot connect to cluster node " << parent << std::endl;
+            return false;
+        }
+        U8 buf[4];
+        for (int i = 0; i < 4; i++)
+            buf[i] = (U8)(rank >> (8 * i));
+        peers[parent].fd = fd;
+        peers[parent].outBuf.assign(buf, buf + 4);
+        while (!flush(parent))
+            waitFd(fd, true);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int c : children) {
+        while (peers[c].fd < 0) {
+            int timeLeft = connectTimeoutMs - elapsedMs(t0);
+            if (timeLeft <= 0 || !acceptPeer(children, timeLeft)) {
+                std::cerr << "Cluster node " << c << " did not connect" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        if (nodes[rank].unixSocket)
+            unlink(nodes[rank].port.c_str());
+    }
+    return true;
+}
+
+bool
+SocketTransport::listen() {
+    const Address& addr = nodes[rank];
+    if (addr.unixSocket) {
+        sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strncpy(sa.sun_path, addr.port.c_str(), sizeof(sa.sun_path) - 1);
+        unlink(sa.sun_path);
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd >= 0 && bind(listenFd, (sockaddr*)&sa, sizeof(sa)) == 0 &&
+            ::listen(listenFd, SOMAXCONN) == 0)
+            return true;
+    } else {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res;
+        if (getaddrinfo(addr.host.c_str(), addr.port.c_str(), &hints, &res) == 0) {
+            for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+                listenFd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+                if (listenFd < 0)
+                    continue;
+                int one = 1;
+                setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                if (bind(listenFd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+                    ::listen(listenFd, SOMAXCONN) == 0)
+                    break;
+                ::close(listenFd);
+                listenFd = -1;
+            }
+            freeaddrinfo(res);
+            if (listenFd >= 0)
+                return true;
+        }
+    }
+    std::cerr << "Cannot listen on cluster node address: " << strerror(errno) << std::endl;
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+    }
+    return false;
+}
+
+int
+SocketTransport::connectTo(const Address& addr) {
+    auto t0 = std::chrono::steady_clock::now();
+    while (true) {
+        int fd = -1;
+        if (addr.unixSocket) {
+            sockaddr_un sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sun_family = AF_UNIX;
+            strncpy(sa.sun_path, addr.port.c_str(), sizeof(sa.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && ::connect(fd, (sockaddr*)&sa, sizeof(sa)) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        } else {
+            addrinfo hints;
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* res;
+            if (getaddrinfo(addr.host.c_str(), addr.port.c_str(), &hints, &res) == 0) {
+                for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+                    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+                    if (fd < 0)
+                        continue;
+                    if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+                        break;
+                    ::close(fd);
+                    fd = -1;
+                }
+                freeaddrinfo(res);
+            }
+            if (fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+        if (fd >= 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            return fd;
+        }
+        if (elapsedMs(t0) > connectTimeoutMs)
+            return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+bool
+SocketTransport::acceptPeer(const std::vector<int>& children, int timeOutMs) {
+    pollfd pfd { listenFd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeOutMs) <= 0) {
+        std::cerr << "Timeout waiting for cluster child nodes" << std::endl;
+        return false;
+    }
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0)
+        return true;
+    if (!nodes[rank].unixSocket) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    // The first four bytes sent by a child node is its node number
+    U8 buf[4];
+    int n = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (n < 4) {
+        pollfd cfd { fd, POLLIN, 0 };
+        int timeLeft = handshakeTimeoutMs - elapsedMs(t0);
+        if (timeLeft <= 0 || poll(&cfd, 1, timeLeft) <= 0)
+            break;
+        int r = ::recv(fd, &buf[n], 4 - n, 0);
+        if (r <= 0)
+            break;
+        n += r;
+    }
+    int peer = -1;
+    if (n == 4)
+        peer = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+    if (std::find(children.begin(), children.end(), peer) == children.end() ||
+        peers[peer].fd >= 0) {
+        std::cerr << "Ignoring invalid cluster node connection" << std::endl;
+        ::close(fd);
+        return true;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    peers[peer].fd = fd;
+    return true;
+}
+
+void
+SocketTransport::close() {
+    for (Peer& p : peers)
+        closePeer(p);
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        if (nodes[rank].unixSocket)
+            unlink(nodes[rank].port.c_str());
+    }
+}
+
+void
+SocketTransport::closePeer(Peer& p) {
+    if (p.fd >= 0) {
+        ::close(p.fd);
+        p.fd = -1;
+    }
+    p.outBuf.clear();
+    p.outPos = 0;
+    p.inBuf.clear();
+    p.inPos = 0;
+}
+
+void
+SocketTransport::compact(std::vector<U8>& buf, size_t& pos) {
+    if (pos == buf.size()) {
+        buf.clear();
+        pos = 0;
+    } else if (pos >= 65536 && pos * 2 >= buf.size()) {
+        buf.erase(buf.begin(), buf.begin() + pos);
+        pos = 0;
+    }
+}
+
+void
+SocketTransport::send(int peer, const U8* buf, int len) {
+    Peer& p = peers[peer];
+    if (p.fd < 0)
+        return;
+    for (int i = 0; i < 4; i++)
+        p.outBuf.push_back((U8)(len >> (8 * i)));
+    p.outBuf.insert(p.outBuf.end(), buf, buf + len);
+    flush(peer);
+}
+
+bool
+SocketTransport::flush(int peer) {
+    Peer& p = peers[peer];
+    if (p.fd < 0) {
+        p.outBuf.clear();
+        p.outPos = 0;
+        return true;
+    }
+    while (p.outPos < p.outBuf.size()) {
+        ssize_t n = ::send(p.fd, &p.outBuf[p.outPos], p.outBuf.size() - p.outPos, sendFlags);
+        if (n > 0) {
+            p.outPos += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closePeer(p);
+            return true;
+        }
+    }
+    compact(p.outBuf, p.outPos);
+    return p.outBuf.empty();
+}
+
+void
+SocketTransport::readAvailable(Peer& p) {
+    U8 buf[65536];
+    while (p.fd >= 0) {
+        ssize_t n = ::recv(p.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            p.inBuf.insert(p.inBuf.end(), buf, buf + n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            ::close(p.fd); // Keep already received messages in inBuf
+            p.fd = -1;
+        }
+    }
+}
+
+bool
+SocketTransport::recv(int peer, U8* buf, int maxLen, int& len) {
+    Peer& p = peers[peer];
+    if (p.inBuf.size() - p.inPos < 4 && p.fd >= 0)
+        readAvailable(p);
+    size_t avail = p.inBuf.size() - p.inPos;
+    if (avail < 4)
+        return false;
+    const U8* msg = &p.inBuf[p.inPos];
+    U32 msgLen = msg[0] | (msg[1] << 8) | (msg[2] << 16) | ((U32)msg[3] << 24);
+    if (msgLen > (U32)maxLen) {
+        std::cerr << "Cluster node " << peer << ": message too large: " << msgLen << std::endl;
+        closePeer(p);
+        return false;
+    }
+    if (avail < 4 + msgLen && p.fd >= 0) {
+        readAvailable(p);
+        avail = p.inBuf.size() - p.inPos;
+        msg = &p.inBuf[p.inPos];
+    }
+    if (avail < 4 + msgLen)
+        return false;
+    len = msgLen;
+    std::copy(msg + 4, msg + 4 + len, buf);
+    p.inPos += 4 + msgLen;
+    compact(p.inBuf, p.inPos);
+    return true;
+}
+
+void
+SocketTransport::sendBlocking(int peer, const U8* buf, int len) {
+    send(peer, buf, len);
+    while (!flush(peer))
+        waitFd(peers[peer].fd, true);
+}
+
+int
+SocketTransport::recvBlocking(int peer, U8* buf, int maxLen) {
+    int len;
+    while (!recv(peer, buf, maxLen, len)) {
+        if (peers[peer].fd < 0)
+            return -1;
+        waitFd(peers[peer].fd, false);
+    }
+    return len;
+}
+
+void
+SocketTransport::waitFd(int fd, bool write) {
+    pollfd pfd { fd, (short)(write ? POLLOUT : POLLIN), 0 };
+    poll(&pfd, 1, 1000);
+}
+
+#endif
@@ -0,0 +1,152 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * socketTransport.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef SOCKETTRANSPORT_HPP_
+#define SOCKETTRANSPORT_HPP_
+
+#ifdef CLUSTER_SOCKETS
+
+#include "util.hpp"
+
+#include <string>
+#include <vector>
+
+
+/** Message passing between cluster nodes using TCP or Unix domain sockets.
+ *  Replaces MPI when the engine is built with USE_CLUSTER_SOCKETS.
+ *
+ *  The cluster nodes are listed in a text file, one node per line. The line
+ *  number (ignoring empty lines and comments starting with '#') is the node
+ *  number. A node is given either as "host:port" for TCP or as "unix:path"
+ *  for a Unix domain socket. A TCP node only listens on the address given
+ *  for it in the node list. Only nodes that are neighbors in the cluster
+ *  tree are connected to each other.
+ *
+ *  Messages are sent and received without blocking. All methods must be
+ *  called from the same thread. */
+class SocketTransport {
+public:
+    SocketTransport() = default;
+    ~SocketTransport();
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    /** Read the node list from a file.
+     *  @return True if successful and rank is a valid node number. */
+    bool readConfig(const std::string& fileName, int rank);
+
+    /** Set the node list directly. Each element has the same syntax as
+     *  a line in the configuration file. */
+    bool setNodes(const std::vector<std::string>& addresses, int rank);
+
+    /** Number of nodes in the cluster. */
+    int getNumberOfNodes() const;
+
+    /** Listen for connections from child nodes, connect to the parent
+     *  node and wait until all child nodes have connected.
+     *  @return True if all connections were established. */
+    bool connect(int parent, const std::vector<int>& children);
+
+    /** Close all connections. */
+    void close();
+
+    /** Return true if the connection to a peer is open. When a connection
+     *  has been lost, recv() still returns already received messages. */
+    bool isConnected(int peer) const;
+
+    /** Start sending a message to a peer. The data is copied. */
+    void send(int peer, const U8* buf, int len);
+
+    /** Try to send pending data to a peer.
+     *  @return True if all previously started sends have completed. */
+    bool flush(int peer);
+
+    /** Try to receive a message from a peer. A message larger than maxLen
+     *  is a protocol error that closes the connection to the peer.
+     *  @return True if a complete message was stored in buf. Its size
+     *          is stored in len. */
+    bool recv(int peer, U8* buf, int maxLen, int& len);
+
+    /** Send a message and wait until it has been sent. */
+    void sendBlocking(int peer, const U8* buf, int len);
+
+    /** Wait until a message has been received from a peer.
+     *  @return The message size, or -1 if the connection was closed. */
+    int recvBlocking(int peer, U8* buf, int maxLen);
+
+private:
+    struct Address {
+        bool unixSocket = false;
+        std::string host;
+        std::string port;  // Port number, or path for a unix socket
+    };
+    struct Peer {
+        int fd = -1;
+        std::vector<U8> outBuf; // Data not yet written to the socket, starting at outPos
+        size_t outPos = 0;
+        std::vector<U8> inBuf;  // Data not yet returned by recv(), starting at inPos
+        size_t inPos = 0;
+    };
+
+    static bool parseAddress(const std::string& str, Address& addr);
+
+    /** Create a listening socket for this node. */
+    bool listen();
+    /** Connect to a peer. Retry until the peer listens or a timeout expires. */
+    int connectTo(const Address& addr);
+    /** Accept a connection and read the peer node number. Connections that
+     *  do not identify themselves as a not yet connected child node within
+     *  a few seconds are closed.
+     *  @return False if no connection was made within timeOutMs. */
+    bool acceptPeer(const std::vector<int>& children, int timeOutMs);
+
+    /** Read all available data from a peer. */
+    void readAvailable(Peer& p);
+    /** Wait until a socket is readable/writable or a timeout expires. */
+    static void waitFd(int fd, bool write);
+    void closePeer(Peer& p);
+    /** Remove consumed data before pos if that is cheap relative to the
+     *  amount of data that has been consumed. */
+    static void compact(std::vector<U8>& buf, size_t& pos);
+
+    std::vector<Address> nodes;
+    int rank = 0;
+    int listenFd = -1;
+    std::vector<Peer> peers; // Indexed by node number
+};
+
+inline int
+SocketTransport::getNumberOfNodes() const {
+    return nodes.size();
+}
+
+inline bool
+SocketTransport::isConnected(int peer) const {
+    return peers[peer].fd >= 0;
+}
+
+#endif
+
+#endif /* SOCKETTRANSPORT_HPP_ */
@@ -140,6 +140,165 @@ MoveGen::pseudoLegalMoves(const Position& pos, MoveList& moveList) {
     }
 }
 
+template void MoveGen::legalMoves<true>(const Position& pos, MoveList& moveList);
+template void MoveGen::legalMoves<false>(const Position& pos, MoveList& moveList);
+
+template <bool wtm>
+void
+MoveGen::legalMoves(const Position& pos, MoveList& moveList) {
+    using MyColor = ColorTraits<wtm>;
+    using OtherColor = ColorTraits<!wtm>;
+    const U64 occupied = pos.occupiedBB();
+    const int first = moveList.size;
+
+    // Compute pieces giving check and own pieces pinned to the king
+    const Square kingSq = pos.getKingSq(wtm);
+    const U64 oRookPieces = pos.pieceTypeBB(OtherColor::ROOK, OtherColor::QUEEN);
+    const U64 oBishPieces = pos.pieceTypeBB(OtherColor::BISHOP, OtherColor::QUEEN);
+    U64 checkers = pos.pieceTypeBB(OtherColor::KNIGHT) & BitBoard::knightAttacks(kingSq);
+    checkers |= pos.pieceTypeBB(OtherColor::PAWN) &
+                (wtm ? BitBoard::wPawnAttacks(kingSq) : BitBoard::bPawnAttacks(kingSq));
+    checkers |= oRookPieces & BitBoard::rookAttacks(kingSq, occupied);
+    checkers |= oBishPieces & BitBoard::bishopAttacks(kingSq, occupied);
+    U64 pinned = 0;
+    U64 pinners = (oRookPieces & BitBoard::rookAttacks(kingSq, 0)) |
+                  (oBishPieces & BitBoard::bishopAttacks(kingSq, 0));
+    while (pinners != 0) {
+        Square sq = BitBoard::extractSquare(pinners);
+        U64 between = BitBoard::squaresBetween(kingSq, sq) & occupied;
+        if ((between != 0) && ((between & (between-1)) == 0))
+            pinned |= between & pos.colorBB(wtm);
+    }
+
+    // Squares non-king moves must go to. In double check only king moves are legal.
+    U64 validTargets = ~pos.colorBB(wtm);
+    if (checkers != 0) {
+        if ((checkers & (checkers-1)) == 0)
+            validTargets = checkers | BitBoard::squaresBetween(kingSq, BitBoard::firstSquare(checkers));
+        else
+            validTargets = 0;
+    }
+
+    // Queen moves
+    U64 squares = pos.pieceTypeBB(MyColor::QUEEN);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = (BitBoard::rookAttacks(sq, occupied) | BitBoard::bishopAttacks(sq, occupied)) & validTargets;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Rook moves
+    squares = pos.pieceTypeBB(MyColor::ROOK);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = BitBoard::rookAttacks(sq, occupied) & validTargets;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Bishop moves
+    squares = pos.pieceTypeBB(MyColor::BISHOP);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = BitBoard::bishopAttacks(sq, occupied) & validTargets;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // King moves
+    {
+        const U64 occNoKing = occupied & ~(1ULL << kingSq);
+        U64 m = BitBoard::kingAttacks(kingSq) & ~pos.colorBB(wtm);
+        while (m != 0) {
+            Square sq = BitBoard::extractSquare(m);
+            if (!sqAttacked<wtm>(pos, sq, occNoKing))
+                moveList.addMove(kingSq, sq, Piece::EMPTY);
+        }
+        const Square k0(wtm ? E1 : E8);
+        if ((kingSq == k0) && (checkers == 0)) {
+            const U64 OO_SQ = wtm ? BitBoard::sqMask(F1,G1) : BitBoard::sqMask(F8,G8);
+            const U64 OOO_SQ = wtm ? BitBoard::sqMask(B1,C1,D1) : BitBoard::sqMask(B8,C8,D8);
+            const int hCastle = wtm ? Position::H1_CASTLE : Position::H8_CASTLE;
+            const int aCastle = wtm ? Position::A1_CASTLE : Position::A8_CASTLE;
+            if (((pos.getCastleMask() & (1 << hCastle)) != 0) &&
+                ((OO_SQ & occupied) == 0) &&
+                (pos.getPiece(k0 + 3) == MyColor::ROOK) &&
+                !sqAttacked<wtm>(pos, k0 + 1, occupied) &&
+                !sqAttacked<wtm>(pos, k0 + 2, occupied)) {
+                moveList.addMove(k0, k0 + 2, Piece::EMPTY);
+            }
+            if (((pos.getCastleMask() & (1 << aCastle)) != 0) &&
+                ((OOO_SQ & occupied) == 0) &&
+                (pos.getPiece(k0 - 4) == MyColor::ROOK) &&
+                !sqAttacked<wtm>(pos, k0 - 1, occupied) &&
+                !sqAttacked<wtm>(pos, k0 - 2, occupied)) {
+                moveList.addMove(k0, k0 - 2, Piece::EMPTY);
+            }
+        }
+    }
+
+    // Knight moves. A pinned knight can never move.
+    U64 knights = pos.pieceTypeBB(MyColor::KNIGHT) & ~pinned;
+    while (knights != 0) {
+        Square sq = BitBoard::extractSquare(knights);
+        U64 m = BitBoard::knightAttacks(sq) & validTargets;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Pawn moves. En passant captures are validated below.
+    const U64 pawns = pos.pieceTypeBB(MyColor::PAWN);
+    const Square epSquare = pos.getEpSquare();
+    const U64 epMask = epSquare.isValid() ? (1ULL << epSquare) : 0ULL;
+    const U64 pawnCaptureTargets = (pos.colorBB(!wtm) & validTargets) | epMask;
+    if (wtm) {
+        U64 m = (pawns << 8) & ~occupied;
+        addPawnMovesByMask<wtm>(moveList, m & validTargets, -8, true);
+        m = ((m & BitBoard::maskRow3) << 8) & ~occupied;
+        addPawnDoubleMovesByMask(moveList, m & validTargets, -16);
+
+        m = (pawns << 7) & BitBoard::maskAToGFiles & pawnCaptureTargets;
+        addPawnMovesByMask<wtm>(moveList, m, -7, true);
+
+        m = (pawns << 9) & BitBoard::maskBToHFiles & pawnCaptureTargets;
+        addPawnMovesByMask<wtm>(moveList, m, -9, true);
+    } else {
+        U64 m = (pawns >> 8) & ~occupied;
+        addPawnMovesByMask<wtm>(moveList, m & validTargets, 8, true);
+        m = ((m & BitBoard::maskRow6) >> 8) & ~occupied;
+        addPawnDoubleMovesByMask(moveList, m & validTargets, 16);
+
+        m = (pawns >> 9) & BitBoard::maskAToGFiles & pawnCaptureTargets;
+        addPawnMovesByMask<wtm>(moveList, m, 9, true);
+
+        m = (pawns >> 7) & BitBoard::maskBToHFiles & pawnCaptureTargets;
+        addPawnMovesByMask<wtm>(moveList, m, 7, true);
+    }
+
+    // Remove moves that leave a pinned piece off its pin line, and illegal
+    // en passant captures. The move order is preserved.
+    if ((pinned == 0) && (epMask == 0))
+        return;
+    int length = first;
+    for (int i = first; i < moveList.size; i++) {
+        const Move& m = moveList[i];
+        const U64 fromMask = 1ULL << m.from();
+        const U64 toMask = 1ULL << m.to();
+        bool legal = true;
+        if ((m.to() == epSquare) && (pos.getPiece(m.from()) == MyColor::PAWN)) {
+            const Square capSq = epSquare + (wtm ? -8 : 8);
+            const U64 capMask = 1ULL << capSq;
+            const U64 occ = (occupied & ~fromMask & ~capMask) | toMask;
+            legal = ((checkers & ~capMask & ~oRookPieces & ~oBishPieces) == 0) &&
+                    ((BitBoard::rookAttacks(kingSq, occ) & oRookPieces) == 0) &&
+                    ((BitBoard::bishopAttacks(kingSq, occ) & oBishPieces) == 0);
+        } else if ((pinned & fromMask) != 0) {
+            legal = ((BitBoard::squaresBetween(kingSq, m.to()) & fromMask) != 0) ||
+                    ((BitBoard::squaresBetween(kingSq, m.from()) & toMask) != 0);
+        }
+        if (legal)
+            moveList[length++] = m;
+    }
+    moveList.size = length;
+}
+
 template void MoveGen::checkEvasions<true>(const Position& pos, MoveList& moveList);
 template void MoveGen::checkEvasions<false>(const Position& pos, MoveList& moveList);
 
@@ -454,6 +613,110 @@ MoveGen::pseudoLegalCaptures(const Position& pos, MoveList& moveList) {
     }
 }
 
+template void MoveGen::pseudoLegalNonCaptures<true>(const Position& pos, MoveList& moveList);
+template void MoveGen::pseudoLegalNonCaptures<false>(const Position& pos, MoveList& moveList);
+
+template <bool wtm>
+void
+MoveGen::pseudoLegalNonCaptures(const Position& pos, MoveList& moveList) {
+    using MyColor = ColorTraits<wtm>;
+    const U64 occupied = pos.occupiedBB();
+    const U64 empty = ~occupied;
+
+    // Queen moves
+    U64 squares = pos.pieceTypeBB(MyColor::QUEEN);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = (BitBoard::rookAttacks(sq, occupied) | BitBoard::bishopAttacks(sq, occupied)) & empty;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Rook moves
+    squares = pos.pieceTypeBB(MyColor::ROOK);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = BitBoard::rookAttacks(sq, occupied) & empty;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Bishop moves
+    squares = pos.pieceTypeBB(MyColor::BISHOP);
+    while (squares != 0) {
+        Square sq = BitBoard::extractSquare(squares);
+        U64 m = BitBoard::bishopAttacks(sq, occupied) & empty;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // King moves
+    {
+        Square sq = pos.getKingSq(wtm);
+        U64 m = BitBoard::kingAttacks(sq) & empty;
+        addMovesByMask(moveList, sq, m);
+        const Square k0(wtm ? E1 : E8);
+        if (sq == k0) {
+            const U64 OO_SQ = wtm ? BitBoard::sqMask(F1,G1) : BitBoard::sqMask(F8,G8);
+            const U64 OOO_SQ = wtm ? BitBoard::sqMask(B1,C1,D1) : BitBoard::sqMask(B8,C8,D8);
+            const int hCastle = wtm ? Position::H1_CASTLE : Position::H8_CASTLE;
+            const int aCastle = wtm ? Position::A1_CASTLE : Position::A8_CASTLE;
+            if (((pos.getCastleMask() & (1 << hCastle)) != 0) &&
+                ((OO_SQ & occupied) == 0) &&
+                (pos.getPiece(k0 + 3) == MyColor::ROOK) &&
+                !sqAttacked(pos, k0) &&
+                !sqAttacked(pos, k0 + 1)) {
+                moveList.addMove(k0, k0 + 2, Piece::EMPTY);
+            }
+            if (((pos.getCastleMask() & (1 << aCastle)) != 0) &&
+                ((OOO_SQ & occupied) == 0) &&
+                (pos.getPiece(k0 - 4) == MyColor::ROOK) &&
+                !sqAttacked(pos, k0) &&
+                !sqAttacked(pos, k0 - 1)) {
+                moveList.addMove(k0, k0 - 2, Piece::EMPTY);
+            }
+        }
+    }
+
+    // Knight moves
+    U64 knights = pos.pieceTypeBB(MyColor::KNIGHT);
+    while (knights != 0) {
+        Square sq = BitBoard::extractSquare(knights);
+        U64 m = BitBoard::knightAttacks(sq) & empty;
+        addMovesByMask(moveList, sq, m);
+    }
+
+    // Pawn moves. Queen and knight promotions are generated by pseudoLegalCaptures().
+    auto addUnderPromotions = [&moveList](U64 mask, int delta) {
+        while (mask != 0) {
+            Square sq = BitBoard::extractSquare(mask);
+            moveList.addMove(sq + delta, sq, MyColor::ROOK);
+            moveList.addMove(sq + delta, sq, MyColor::BISHOP);
+        }
+    };
+    const U64 pawns = pos.pieceTypeBB(MyColor::PAWN);
+    if (wtm) {
+        U64 m = (pawns << 8) & empty;
+        addUnderPromotions(m & BitBoard::maskRow8, -8);
+        addPawnMovesByMask<wtm>(moveList, m & ~BitBoard::maskRow8, -8, true);
+        m = ((m & BitBoard::maskRow3) << 8) & empty;
+        addPawnDoubleMovesByMask(moveList, m, -16);
+
+        m = (pawns << 7) & BitBoard::maskAToGFiles & pos.colorBB(!wtm) & BitBoard::maskRow8;
+        addUnderPromotions(m, -7);
+        m = (pawns << 9) & BitBoard::maskBToHFiles & pos.colorBB(!wtm) & BitBoard::maskRow8;
+        addUnderPromotions(m, -9);
+    } else {
+        U64 m = (pawns >> 8) & empty;
+        addUnderPromotions(m & BitBoard::maskRow1, 8);
+        addPawnMovesByMask<wtm>(moveList, m & ~BitBoard::maskRow1, 8, true);
+        m = ((m & BitBoard::maskRow6) >> 8) & empty;
+        addPawnDoubleMovesByMask(moveList, m, 16);
+
+        m = (pawns >> 9) & BitBoard::maskAToGFiles & pos.colorBB(!wtm) & BitBoard::maskRow1;
+        addUnderPromotions(m, 9);
+        m = (pawns >> 7) & BitBoard::maskBToHFiles & pos.colorBB(!wtm) & BitBoard::maskRow1;
+        addUnderPromotions(m, 7);
+    }
+}
+
 bool
 MoveGen::givesCheck(const Position& pos, const Move& m) {
     bool wtm = pos.isWhiteMove();
@@ -657,3 +920,76 @@ MoveGen::isLegal(Position& pos, const Move& m, bool isInCheck) {
         }
     }
 }
+
+bool
+MoveGen::isPseudoLegal(const Position& pos, const Move& m) {
+    const bool wtm = pos.isWhiteMove();
+    const Square from = m.from();
+    const Square to = m.to();
+    const int p = pos.getPiece(from);
+    if (p == Piece::EMPTY || Piece::isWhite(p) != wtm)
+        return false;
+    const U64 toMask = 1ULL << to;
+    if (pos.colorBB(wtm) & toMask)
+        return false;
+
+    const int pType = Piece::makeWhite(p);
+    const int promoteTo = m.promoteTo();
+    if (pType != Piece::WPAWN && promoteTo != Piece::EMPTY)
+        return false;
+
+    const U64 occupied = pos.occupiedBB();
+    switch (pType) {
+    case Piece::WQUEEN:
+        return ((BitBoard::rookAttacks(from, occupied) |
+                 BitBoard::bishopAttacks(from, occupied)) & toMask) != 0;
+    case Piece::WROOK:
+        return (BitBoard::rookAttacks(from, occupied) & toMask) != 0;
+    case Piece::WBISHOP:
+        return (BitBoard::bishopAttacks(from, occupied) & toMask) != 0;
+    case Piece::WKNIGHT:
+        return (BitBoard::knightAttacks(from) & toMask) != 0;
+    case Piece::WKING: {
+        if (BitBoard::kingAttacks(from) & toMask)
+            return true;
+        const Square k0(wtm ? E1 : E8);
+        if (from != k0 || (to != k0 + 2 && to != k0 - 2))
+            return false;
+        const bool hSide = to == k0 + 2;
+        const int castle = wtm ? (hSide ? Position::H1_CASTLE : Position::A1_CASTLE)
+                               : (hSide ? Position::H8_CASTLE : Position::A8_CASTLE);
+        const U64 emptySq = wtm ? (hSide ? BitBoard::sqMask(F1,G1) : BitBoard::sqMask(B1,C1,D1))
+                                : (hSide ? BitBoard::sqMask(F8,G8) : BitBoard::sqMask(B8,C8,D8));
+        const int rook = wtm ? Piece::WROOK : Piece::BROOK;
+        return ((pos.getCastleMask() & (1 << castle)) != 0) &&
+               ((emptySq & occupied) == 0) &&
+               (pos.getPiece(hSide ? k0 + 3 : k0 - 4) == rook) &&
+               !sqAttacked(pos, k0) &&
+               !sqAttacked(pos, hSide ? k0 + 1 : k0 - 1);
+    }
+    case Piece::WPAWN: {
+        const bool lastRank = to.getY() == (wtm ? 7 : 0);
+        if (lastRank) {
+            if (promoteTo == Piece::EMPTY || Piece::isWhite(promoteTo) != wtm ||
+                Piece::makeWhite(promoteTo) == Piece::WKING ||
+                Piece::makeWhite(promoteTo) == Piece::WPAWN)
+                return false;
+        } else if (promoteTo != Piece::EMPTY) {
+            return false;
+        }
+        const int dir = wtm ? 8 : -8;
+        if (to == from + dir)
+            return (occupied & toMask) == 0;
+        if (to == from + 2 * dir)
+            return (from.getY() == (wtm ? 1 : 6)) &&
+                   (pos.getPiece(from + dir) == Piece::EMPTY) &&
+                   ((occupied & toMask) == 0);
+        const U64 pawnAtks = wtm ? BitBoard::bPawnAttacks(to) : BitBoard::wPawnAttacks(to);
+        if ((pawnAtks & (1ULL << from)) == 0)
+            return false;
+        return (pos.colorBB(!wtm) & toMask) || (to == pos.getEpSquare());
+    }
+    default:
+        return false;
+    }
+}
@@ -69,6 +69,15 @@ public:
     static void pseudoLegalMoves(const Position& pos, MoveList& moveList);
     static void pseudoLegalMoves(const Position& pos, MoveList& moveList);
 
+    /**
+     * Generate and return a list of legal moves. Pinned pieces and pieces giving
+     * check are computed once, so no moves need to be made to test legality.
+     * The moves are generated in the same order as by pseudoLegalMoves().
+     */
+    template <bool wtm>
+    static void legalMoves(const Position& pos, MoveList& moveList);
+    static void legalMoves(const Position& pos, MoveList& moveList);
+
     /**
      * Generate and return a list of pseudo-legal check evasion moves.
      * Pseudo-legal means that the moves don't necessarily defend from check threats.
@@ -87,6 +96,18 @@ public:
     static void pseudoLegalCaptures(const Position& pos, MoveList& moveList);
     static void pseudoLegalCaptures(const Position& pos, MoveList& moveList);
 
+    /** Generate the pseudo-legal moves not generated by pseudoLegalCaptures(),
+     *  i.e. non-captures, castling and rook/bishop promotions. Together the two
+     *  functions generate the same moves as pseudoLegalMoves(). */
+    template <bool wtm>
+    static void pseudoLegalNonCaptures(const Position& pos, MoveList& moveList);
+    static void pseudoLegalNonCaptures(const Position& pos, MoveList& moveList);
+
+    /** Return true if "move" would be generated by pseudoLegalMoves(pos).
+     *  Can be used to validate moves from the transposition table or killer
+     *  table without generating all moves. */
+    static bool isPseudoLegal(const Position& pos, const Move& move);
+
     /** Return true if the side to move is in check. */
     static bool inCheck(const Position& pos);
 
@@ -162,6 +183,14 @@ MoveGen::pseudoLegalMoves(const Position& pos, MoveList& moveList) {
         pseudoLegalMoves<false>(pos, moveList);
 }
 
+inline void
+MoveGen::legalMoves(const Position& pos, MoveList& moveList) {
+    if (pos.isWhiteMove())
+        legalMoves<true>(pos, moveList);
+    else
+        legalMoves<false>(pos, moveList);
+}
+
 inline void
 MoveGen::checkEvasions(const Position& pos, MoveList& moveList) {
     if (pos.isWhiteMove())
@@ -186,6 +215,14 @@ MoveGen::pseudoLegalCaptures(const Position& pos, MoveList& moveList) {
         pseudoLegalCaptures<false>(pos, moveList);
 }
 
+inline void
+MoveGen::pseudoLegalNonCaptures(const Position& pos, MoveList& moveList) {
+    if (pos.isWhiteMove())
+        pseudoLegalNonCaptures<true>(pos, moveList);
+    else
+        pseudoLegalNonCaptures<false>(pos, moveList);
+}
+
 inline bool
 MoveGen::inCheck(const Position& pos) {
     Square kingSq = pos.getKingSq(pos.isWhiteMove());
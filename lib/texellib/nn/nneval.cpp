@@ -59,12 +59,22 @@ NNEvaluator::create(const NetData& netData) {
 }
 
 NNEvaluator::NNEvaluator(const NetData& netData)
-    : layer2(netData.lin2),
-      layer3(netData.lin3),
-      layer4(netData.lin4),
-      netData(netData) {
+    : netData(netData), kernels(NNKernels::instance()) {
     static_assert(sizeof(FirstLayerState) % 32 == 0, "Bad alignment");
     static_assert(sizeof(FirstLayerStack) % 32 == 0, "Bad alignment");
+    static_assert(sizeof(RefreshEntry) % 32 == 0, "Bad alignment");
+    for (int c = 0; c < 2; c++) {
+        for (RefreshEntry& e : refreshCache[c]) {
+            if (netData.weight1S8) {
+                for (S16& v : e.l1Out.data)
+                    v = 0;
+            } else {
+                copyVec(e.l1Out, netData.bias1);
+            }
+            for (U64& bb : e.pieces)
+                bb = 0;
+        }
+    }
 }
 
 NNEvaluator::~NNEvaluator() {
@@ -179,50 +189,52 @@ NNEvaluator::setPiece(Square square, int oldPiece, int newPiece) {
 
 void
 NNEvaluator::computeL1WB() {
-    bool doFull[2];
-    Square kingSq[2];
-    kingSq[0] = posP->getKingSq(true);
-    kingSq[1] = posP->getKingSq(false);
     for (int c = 0; c < 2; c++) {
         FirstLayerState& s = getLinState(c);
-        doFull[c] = s.kingSqComputed != kingSq[c];
-        if (!doFull[c])
-            addSubWeights(s.l1Out, netData.weight1, s.toAdd, s.toAddLen, s.toSub, s.toSubLen);
+        if (s.kingSqComputed == posP->getKingSq(c == 0)) {
+            kernels.addSubWeights(s.l1Out, netData, s.toAdd, s.toAddLen, s.toSub, s.toSubLen);
+        } else {
+            refreshL1(c);
+        }
         s.toAddLen = 0;
         s.toSubLen = 0;
     }
+}
 
-    if (!doFull[0] && !doFull[1])
-        return;
+void
+NNEvaluator::refreshL1(int c) {
+    FirstLayerState& s = getLinState(c);
+    copyVec(s.l1Out, updateRefreshEntry(*posP, c));
+    s.kingSqComputed = posP->getKingSq(c == 0);
+}
 
-    for (int c = 0; c < 2; c++) {
-        if (doFull[c]) {
-            FirstLayerState& s = getLinState(c);
-            copyVec(s.l1Out, netData.bias1);
-            s.kingSqComputed = posP->getKingSq(c == 0);
-        }
-    }
+const Vector<S16,NetData::n1>&
+NNEvaluator::updateRefreshEntry(const Position& pos, int c) {
+    static const Piece::Type pieces[] = {
+        Piece::WQUEEN, Piece::WROOK, Piece::WBISHOP, Piece::WKNIGHT, Piece::WPAWN,
+        Piece::BQUEEN, Piece::BROOK, Piece::BBISHOP, Piece::BKNIGHT, Piece::BPAWN,
+    };
 
-    int add[2][32];
-    int len[2] = {0, 0};
-    for (Square sq : AllSquares()) {
-        const int p = posP->getPiece(sq);
-        if (p == Piece::EMPTY || p == Piece::WKING || p == Piece::BKING)
-            continue;
-        int pt = ptValue[p];
-        for (int c = 0; c < 2; c++) {
-            if (doFull[c]) {
-                FirstLayerState& s = getLinState(c);
-                add[c][len[c]++] = getIndex(s.kingSqComputed, pt, sq, c == 0);
-            }
-        }
-    }
-    for (int c = 0; c < 2; c++) {
-        if (doFull[c]) {
-            FirstLayerState& s = getLinState(c);
-            addSubWeights(s.l1Out, netData.weight1, add[c], len[c], add[c], 0);
-        }
+    const bool white = c == 0;
+    const Square kSq = pos.getKingSq(white);
+    RefreshEntry& e = refreshCache[c][kSq.asInt()];
+
+    int add[32], sub[32];
+    int nAdd = 0, nSub = 0;
+    for (Piece::Type p : pieces) {
+        const int pt = ptValue[p];
+        const U64 oldBB = e.pieces[pt];
+        const U64 newBB = pos.pieceTypeBB(p);
+        U64 m = newBB & ~oldBB;
+        while (m)
+            add[nAdd++] = getIndex(kSq, pt, BitBoard::extractSquare(m), white);
+        m = oldBB & ~newBB;
+        while (m)
+            sub[nSub++] = getIndex(kSq, pt, BitBoard::extractSquare(m), white);
+        e.pieces[pt] = newBB;
     }
+    kernels.addSubWeights(e.l1Out, netData, add, nAdd, sub, nSub);
+    return e.l1Out;
 }
 
 void
@@ -230,7 +242,7 @@ NNEvaluator::computeL1Out() {
     bool wtm = posP->isWhiteMove();
     for (int c = 0; c < 2; c++) {
         const Vector<S16, n1>& l1OutC = getLinState(wtm ? c : (1-c)).l1Out;
-        scaleClipPack<NetData::l1Shift>(&l1OutClipped(c * n1), l1OutC);
+        kernels.scaleClipPack(&l1OutClipped(c * n1), l1OutC, netData);
     }
 }
 
@@ -239,9 +251,27 @@ NNEvaluator::eval() {
     computeL1WB();
     computeL1Out();
 
-    layer2.forward(l1OutClipped, layer2Out);
-    layer3.forward(layer2Out.output, layer3Out);
-    layer4.evalLinear(layer3Out.output, layer4Out);
+    int out = kernels.evalLayers(netData, l1OutClipped, layerOut);
+    return out * (100 * 2) / (127 * 64);
+}
 
-    return layer4Out.linOutput(0) * (100 * 2) / (127 * 64);
+void
+NNEvaluator::evalBatch(const Position* positions, int n, int* out) {
+    while (n > 0) {
+        const int nb = std::min(n, NNKernels::batchSize);
+        for (int i = 0; i < nb; i++) {
+            const Position& pos = positions[i];
+            bool wtm = pos.isWhiteMove();
+            for (int c = 0; c < 2; c++) {
+                const Vector<S16, n1>& l1OutC = updateRefreshEntry(pos, wtm ? c : (1-c));
+                kernels.scaleClipPack(&batchIn[i](c * n1), l1OutC, netData);
+            }
+        }
+        kernels.evalLayersBatch(netData, batchIn, nb, out);
+        for (int i = 0; i < nb; i++)
+            out[i] = out[i] * (100 * 2) / (127 * 64);
+        positions += nb;
+        out += nb;
+        n -= nb;
+    }
 }
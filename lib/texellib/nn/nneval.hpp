@@ -27,6 +27,7 @@
 #define NNEVAL_HPP_
 
 #include "nntypes.hpp"
+#include "nnkernels.hpp"
 #include "util.hpp"
 #include "piece.hpp"
 #include "square.hpp"
@@ -66,6 +67,14 @@ public:
      *         Positive values are good for the side to make the next move. */
     int eval();
 
+    /** Evaluate "n" unrelated positions, which do not need to be connected to
+     *  this object. The first layer output for each position is computed from
+     *  the refresh cache, and the following layers are evaluated for a block
+     *  of positions at a time. Does not affect the incremental state, so
+     *  eval() can be used for the connected position afterwards.
+     * @param out Evaluation scores, with the same meaning as for eval(). */
+    void evalBatch(const Position* positions, int n, int* out);
+
     /** Get the first layer output for feature f. 0 <= f < 2*n1. */
     int getL1OutClipped(int f) const;
 
@@ -79,6 +88,15 @@ private:
     void computeL1WB();
     void computeL1Out();
 
+    /** Make the first layer state for side "c" valid for the current king
+     *  square, starting from the refresh cache entry for that square. */
+    void refreshL1(int c);
+
+    /** Update the refresh cache entry for side "c" and the king square in
+     *  "pos" to correspond to the pieces in "pos".
+     * @return The first layer linear output of the updated entry. */
+    const Vector<S16,NetData::n1>& updateRefreshEntry(const Position& pos, int c);
+
     struct FirstLayerState;
     /** Get first layer linear state. */
     FirstLayerState& getLinState(int c);
@@ -107,22 +125,24 @@ private:
     };
     FirstLayerStack stack;
 
-    Vector<S8, 2*n1> l1OutClipped; // l1Out after scaling, clipped ReLU and narrowing, reordered by wtm
-
-    using Layer2 = Layer<n1*2, n2, true >;
-    using Layer3 = Layer<n2  , n3, false>;
-    using Layer4 = Layer<n3  , 1 , false>;
+    /** First layer output previously computed for a given side and king square.
+     *  When the king moves to a square, only the difference between the
+     *  current pieces and the cached pieces has to be applied. */
+    struct RefreshEntry {
+        Vector<S16, n1> l1Out;  // Linear output corresponding to "pieces"
+        U64 pieces[10];         // Bitboard for each non-king piece type, indexed by ptValue
+        U64 pad[2];             // To make size a multiple of 32 bytes
+    };
+    RefreshEntry refreshCache[2][64];
 
-    Layer2::Output layer2Out;
-    Layer3::Output layer3Out;
-    Layer4::Output layer4Out;
+    Vector<S8, 2*n1> l1OutClipped; // l1Out after scaling, clipped ReLU and narrowing, reordered by wtm
+    Vector<S8, 2*n1> batchIn[NNKernels::batchSize]; // l1OutClipped for each position in an evalBatch() block
 
-    Layer2 layer2;
-    Layer3 layer3;
-    Layer4 layer4;
+    NNKernels::LayerOutputs layerOut; // Output from layers after the first layer
 
     const Position* posP = nullptr; // Connected Position object
     const NetData& netData;         // Network weight/bias
+    const NNKernels& kernels;       // Instruction set specific functions
 
     static int ptValue[Piece::nPieceTypes]; // Conversion from Piece to piece values used by NN
 };
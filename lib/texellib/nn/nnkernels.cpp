@@ -0,0 +1,62 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nnkernels.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#include "nnkernelsimpl.hpp"
+
+#ifdef USE_RUNTIME_DISPATCH
+// Defined in the nnkernels<isa>.cpp files, which are compiled with
+// instruction set specific compiler options.
+const NNKernels& getNNKernelsSsse3();
+const NNKernels& getNNKernelsAvx2();
+const NNKernels& getNNKernelsAvx512();
+const NNKernels& getNNKernelsAvx512Vnni();
+
+/** Return the best kernel functions supported by the CPU. */
+static const NNKernels&
+selectNNKernels() {
+    static const NNKernels generic = getNNKernels();
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        if (__builtin_cpu_supports("avx512vnni"))
+            return getNNKernelsAvx512Vnni();
+        return getNNKernelsAvx512();
+    }
+    if (__builtin_cpu_supports("avx2"))
+        return getNNKernelsAvx2();
+    if (__builtin_cpu_supports("ssse3"))
+        return getNNKernelsSsse3();
+    return generic;
+}
+#endif
+
+const NNKernels&
+NNKernels::instance() {
+#ifdef USE_RUNTIME_DISPATCH
+    static const NNKernels& kernels = selectNNKernels();
+#else
+    static const NNKernels kernels = getNNKernels();
+#endif
+    return kernels;
+}
@@ -0,0 +1,88 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nnkernels.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef NNKERNELS_HPP_
+#define NNKERNELS_HPP_
+
+#include "nntypes.hpp"
+
+/**
+ * The neural network evaluation functions that depend on the CPU instruction
+ * set. Normally the functions are compiled for the instruction set selected
+ * when building the program. If the program is built with runtime dispatch,
+ * the functions are compiled for several instruction sets and the best
+ * version supported by the CPU is selected at program startup.
+ */
+class NNKernels {
+public:
+    static constexpr int inFeatures = NetData::inFeatures;
+    static constexpr int n1 = NetData::n1;
+    static constexpr int n2 = NetData::n2;
+    static constexpr int n3 = NetData::n3;
+
+    /** Max number of positions handled by one evalLayersBatch() call. */
+    static constexpr int batchSize = 16;
+
+    /** Outputs from the layers following the first layer. */
+    struct LayerOutputs {
+        LayerOutput<n2> layer2Out;
+        LayerOutput<n3> layer3Out;
+        LayerOutput<1>  layer4Out;
+    };
+
+    /** Name of the instruction set the functions are compiled for. */
+    const char* name;
+
+    /** Rearrange the weights in "net" to the layout required by evalLayers(). */
+    void (*prepareMatMul)(NetData& net);
+
+    /** Add/subtract rows of the first layer weights in "net" to/from "l1Out".
+     *  If net.weight1S8 is true, l1Out does not include the bias and the
+     *  per output scale factor. */
+    void (*addSubWeights)(Vector<S16,n1>& l1Out, const NetData& net,
+                          const int* toAdd, int toAddLen,
+                          const int* toSub, int toSubLen);
+
+    /** Apply scaling, clipped ReLU and narrowing to the first layer output
+     *  corresponding to one side. */
+    void (*scaleClipPack)(S8* out, const Vector<S16,n1>& l1OutC, const NetData& net);
+
+    /** Evaluate all layers after the first layer.
+     *  @return The linear output of the last layer. */
+    int (*evalLayers)(const NetData& net, const Vector<S8,2*n1>& l1OutClipped,
+                      LayerOutputs& out);
+
+    /** Evaluate all layers after the first layer for "n" positions, n <= batchSize.
+     *  Each layer is evaluated for all positions before moving on to the next
+     *  layer, so the layer weights are only loaded into cache once per batch.
+     *  out[i] is set to the linear output of the last layer for position i. */
+    void (*evalLayersBatch)(const NetData& net, const Vector<S8,2*n1>* l1OutClipped,
+                            int n, int* out);
+
+    /** Get the functions to use on the CPU running the program. */
+    static const NNKernels& instance();
+};
+
+#endif /* NNKERNELS_HPP_ */
@@ -0,0 +1,121 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nnkernelsimpl.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef NNKERNELSIMPL_HPP_
+#define NNKERNELSIMPL_HPP_
+
+// Implementation of the NNKernels functions for the instruction set enabled
+// when compiling the including source file. If VECTOROP_NAMESPACE is defined,
+// all functions are placed in that namespace.
+
+#include "nnkernels.hpp"
+#include "vectorop.hpp"
+
+#ifdef VECTOROP_NAMESPACE
+namespace VECTOROP_NAMESPACE {
+#endif
+
+static void
+prepareMatMulImpl(NetData& net) {
+    prepareMatMul(net.lin2.weight);
+    prepareMatMul(net.lin3.weight);
+    prepareMatMul(net.lin4.weight);
+}
+
+static void
+addSubWeightsImpl(Vector<S16,NNKernels::n1>& l1Out, const NetData& net,
+                  const int* toAdd, int toAddLen,
+                  const int* toSub, int toSubLen) {
+    if (net.weight1S8)
+        addSubWeights(l1Out, net.weight1q, toAdd, toAddLen, toSub, toSubLen);
+    else
+        addSubWeights(l1Out, net.weight1, toAdd, toAddLen, toSub, toSubLen);
+}
+
+static void
+scaleClipPackImpl(S8* out, const Vector<S16,NNKernels::n1>& l1OutC, const NetData& net) {
+    if (net.weight1S8) {
+        alignas(64) Vector<S16,NNKernels::n1> l1Out;
+        scaleL1Out(l1Out, l1OutC, net.scale1, net.bias1);
+        scaleClipPack<NetData::l1Shift>(out, l1Out);
+    } else {
+        scaleClipPack<NetData::l1Shift>(out, l1OutC);
+    }
+}
+
+static int
+evalLayersImpl(const NetData& net, const Vector<S8,2*NNKernels::n1>& l1OutClipped,
+               NNKernels::LayerOutputs& out) {
+    forward<true>(net.lin2, l1OutClipped, out.layer2Out);
+    forward<false>(net.lin3, out.layer2Out.output, out.layer3Out);
+    evalLinear<false>(net.lin4, out.layer3Out.output, out.layer4Out);
+    return out.layer4Out.linOutput(0);
+}
+
+static void
+evalLayersBatchImpl(const NetData& net, const Vector<S8,2*NNKernels::n1>* l1OutClipped,
+                    int n, int* out) {
+    constexpr int batchSize = NNKernels::batchSize;
+    alignas(64) LayerOutput<NNKernels::n2> layer2Out[batchSize];
+    alignas(64) LayerOutput<NNKernels::n3> layer3Out[batchSize];
+    alignas(64) LayerOutput<1> layer4Out;
+    for (int i = 0; i < n; i++)
+        forward<true>(net.lin2, l1OutClipped[i], layer2Out[i]);
+    for (int i = 0; i < n; i++)
+        forward<false>(net.lin3, layer2Out[i].output, layer3Out[i]);
+    for (int i = 0; i < n; i++) {
+        evalLinear<false>(net.lin4, layer3Out[i].output, layer4Out);
+        out[i] = layer4Out.linOutput(0);
+    }
+}
+
+/** Return the kernel functions defined in this file. */
+static NNKernels
+getNNKernels() {
+    const char* name =
+#if defined(HAS_AVX512_VNNI)
+        "avx512vnni";
+#elif defined(HAS_AVX512)
+        "avx512";
+#elif defined(HAS_AVX2)
+        "avx2";
+#elif defined(HAS_SSSE3)
+        "ssse3";
+#elif defined(HAS_NEON_DOT)
+        "neondot";
+#elif defined(HAS_NEON)
+        "neon";
+#else
+        "generic";
+#endif
+    return NNKernels{ name, prepareMatMulImpl, addSubWeightsImpl,
+                      scaleClipPackImpl, evalLayersImpl, evalLayersBatchImpl };
+}
+
+#ifdef VECTOROP_NAMESPACE
+}
+#endif
+
+#endif /* NNKERNELSIMPL_HPP_ */
@@ -0,0 +1,36 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nnkernelsssse3.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+// Only used when building with runtime dispatch. The compiler options enabling
+// the instruction set are set for this file in CMakeLists.txt.
+
+#define VECTOROP_NAMESPACE vectorop_ssse3
+#include "nnkernelsimpl.hpp"
+
+const NNKernels&
+getNNKernelsSsse3() {
+    static const NNKernels kernels = VECTOROP_NAMESPACE::getNNKernels();
+    return kernels;
+}
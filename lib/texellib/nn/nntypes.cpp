@@ -26,10 +26,51 @@
 #include "nntypes.hpp"
 #include "chessError.hpp"
 #include "alignedAlloc.hpp"
-#include "vectorop.hpp"
+#include "nnkernels.hpp"
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 static const U64 magicHeader = 0xb3828c6bdf56c56cULL;
 static const int netVersion = 0;
+static const int netVersionS8 = 1;   // Version using 8-bit first layer weights
+
+static const U64 imageMagic = 0x3c8f1ad2e47b6950ULL;
+static const int imageVersion = 0;
+
+/** Header stored before the NetData object in a network image file.
+ *  The size is a multiple of 64 to keep the NetData object aligned. */
+struct ImageHeader {
+    U64 magic;
+    int version;
+    int netVersion;
+    U64 dataSize;       // sizeof(NetData)
+    char layout[16];    // Name of the NNKernels used to prepare the weights
+    U64 hash;           // NetData::computeHash() of the prepared weights
+    U8 pad[16];
+};
+static_assert(sizeof(ImageHeader) % 64 == 0, "Bad alignment");
+
+/** Return the image header corresponding to the current program. */
+static ImageHeader
+getImageHeader() {
+    ImageHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = imageMagic;
+    h.version = imageVersion;
+    h.netVersion = netVersion;
+    h.dataSize = sizeof(NetData);
+    strncpy(h.layout, NNKernels::instance().name, sizeof(h.layout) - 1);
+    return h;
+}
 
 
 std::shared_ptr<NetData>
@@ -45,9 +86,14 @@ void
 NetData::save(std::ostream& os) const {
     BinaryFileWriter writer(os);
     writer.writeScalar(magicHeader);
-    writer.writeScalar(netVersion);
+    writer.writeScalar(weight1S8 ? netVersionS8 : netVersion);
 
-    writer.writeArray(&weight1.data[0], COUNT_OF(weight1.data));
+    if (weight1S8) {
+        writer.writeArray(&weight1q.data[0], COUNT_OF(weight1q.data));
+        writer.writeArray(&scale1.data[0], COUNT_OF(scale1.data));
+    } else {
+        writer.writeArray(&weight1.data[0], COUNT_OF(weight1.data));
+    }
     writer.writeArray(&bias1.data[0], COUNT_OF(bias1.data));
     lin2.save(writer);
     lin3.save(writer);
@@ -67,10 +113,16 @@ NetData::load(std::istream& is) {
 
     int ver;
     reader.readScalar(ver);
-    if (ver != netVersion)
+    if (ver != netVersion && ver != netVersionS8)
         throw ChessError("Incorrect network version number");
 
-    reader.readArray(&weight1.data[0], COUNT_OF(weight1.data));
+    weight1S8 = ver == netVersionS8;
+    if (weight1S8) {
+        reader.readArray(&weight1q.data[0], COUNT_OF(weight1q.data));
+        reader.readArray(&scale1.data[0], COUNT_OF(scale1.data));
+    } else {
+        reader.readArray(&weight1.data[0], COUNT_OF(weight1.data));
+    }
     reader.readArray(&bias1.data[0], COUNT_OF(bias1.data));
     lin2.load(reader);
     lin3.load(reader);
@@ -84,17 +136,117 @@ NetData::load(std::istream& is) {
     prepareMatMul();
 }
 
+void
+NetData::quantizeWeight1() {
+    if (weight1S8)
+        return;
+
+    for (int j = 0; j < n1; j++) {
+        int maxAbs = 0;
+        for (int i = 0; i < inFeatures; i++)
+            maxAbs = std::max(maxAbs, std::abs((int)weight1(i, j)));
+        scale1(j) = std::max(1, (maxAbs + 126) / 127);
+    }
+
+    std::vector<S16> w16(&weight1.data[0], &weight1.data[0] + COUNT_OF(weight1.data));
+    memset(&weight1.data[0], 0, sizeof(weight1));
+    for (int i = 0; i < inFeatures; i++) {
+        for (int j = 0; j < n1; j++) {
+            int w = w16[i * n1 + j];
+            int scale = scale1(j);
+            int q = (w >= 0) ? (w + scale / 2) / scale : -((-w + scale / 2) / scale);
+            weight1q(i, j) = clamp(q, -127, 127);
+        }
+    }
+    weight1S8 = true;
+}
+
 void
 NetData::prepareMatMul() {
-    ::prepareMatMul(lin2.weight);
-    ::prepareMatMul(lin3.weight);
-    ::prepareMatMul(lin4.weight);
+    NNKernels::instance().prepareMatMul(*this);
+}
+
+bool
+NetData::saveImage(const std::string& filename) const {
+    std::ofstream os(filename, std::ios::binary);
+    if (!os)
+        return false;
+    ImageHeader h = getImageHeader();
+    h.netVersion = weight1S8 ? netVersionS8 : netVersion;
+    h.hash = computeHash();
+    os.write((const char*)&h, sizeof(h));
+    os.write((const char*)this, sizeof(NetData));
+    os.close();
+    return !!os;
+}
+
+std::shared_ptr<const NetData>
+NetData::mapImage(const std::string& filename) {
+    const U64 fileSize = sizeof(ImageHeader) + sizeof(NetData);
+    const ImageHeader expected = getImageHeader();
+    auto headerOk = [&expected](const ImageHeader& h) -> bool {
+        return h.magic == expected.magic &&
+               h.version == expected.version &&
+               (h.netVersion == netVersion || h.netVersion == netVersionS8) &&
+               h.dataSize == expected.dataSize &&
+               strncmp(h.layout, expected.layout, sizeof(h.layout)) == 0;
+    };
+    ImageHeader h;
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) != 0 || (U64)statBuf.st_size != fileSize) {
+        ::close(fd);
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        return nullptr;
+    memcpy(&h, mem, sizeof(h));
+    if (!headerOk(h)) {
+        munmap(mem, fileSize);
+        return nullptr;
+    }
+    const NetData* net = (const NetData*)((const U8*)mem + sizeof(ImageHeader));
+    if (net->computeHash() != h.hash) { // Stale or corrupt image
+        munmap(mem, fileSize);
+        return nullptr;
+    }
+    return std::shared_ptr<const NetData>(net, [mem,fileSize](const NetData*) {
+        munmap(mem, fileSize);
+    });
+#else
+    std::ifstream is(filename, std::ios::binary);
+    if (!is)
+        return nullptr;
+    is.seekg(0, std::ios::end);
+    if ((U64)is.tellg() != fileSize)
+        return nullptr;
+    is.seekg(0, std::ios::beg);
+    is.read((char*)&h, sizeof(h));
+    if (!is || !headerOk(h))
+        return nullptr;
+    std::shared_ptr<NetData> net = create();
+    is.read((char*)net.get(), sizeof(NetData));
+    if (!is || net->computeHash() != h.hash)
+        return nullptr;
+    return net;
+#endif
 }
 
 U64
 NetData::computeHash() const {
     U64 ret = hashU64(1);
-    ret = hashU64(ret + weight1.computeHash());
+    if (weight1S8) {
+        ret = hashU64(ret + weight1q.computeHash());
+        ret = hashU64(ret + scale1.computeHash());
+    } else {
+        ret = hashU64(ret + weight1.computeHash());
+    }
     ret = hashU64(ret + bias1.computeHash());
     ret = hashU64(ret + lin2.computeHash());
     ret = hashU64(ret + lin3.computeHash());
@@ -105,7 +257,12 @@ NetData::computeHash() const {
 int
 NetData::computeSize() const {
     U64 s = sizeof(U64) + sizeof(int); // header, ver
-    s += COUNT_OF(weight1.data) * sizeof(weight1.data[0]);
+    if (weight1S8) {
+        s += COUNT_OF(weight1q.data) * sizeof(weight1q.data[0]);
+        s += COUNT_OF(scale1.data) * sizeof(scale1.data[0]);
+    } else {
+        s += COUNT_OF(weight1.data) * sizeof(weight1.data[0]);
+    }
     s += COUNT_OF(bias1.data) * sizeof(bias1.data[0]);
     s += lin2.computeSize();
     s += lin3.computeSize();
@@ -127,22 +127,11 @@ LayerData<nIn,nOut>::computeSize() const {
 
 // ------------------------------------------------------------------------------
 
-template <int nIn, int nOut, bool sparse>
-class Layer {
-public:
-    Layer(const LayerData<nIn,nOut>& data) : data(data) {}
-
-    struct Output {
-        Vector<S32,nOut> linOutput;  // Result after applying weight and bias
-        Vector<S8,nOut> output;      // Result after scaling, clipped ReLU and narrowing
-    };
-
-    /** Compute output from input. */
-    void forward(const Vector<S8,nIn>& in, Output& out);
-    /** Compute linOutput from input. */
-    void evalLinear(const Vector<S8,nIn>& in, Output& out);
-
-    const LayerData<nIn,nOut>& data;
+/** Output from a network layer having nOut outputs. */
+template <int nOut>
+struct LayerOutput {
+    Vector<S32,nOut> linOutput;  // Result after applying weight and bias
+    Vector<S8,nOut> output;      // Result after scaling, clipped ReLU and narrowing
 };
 
 // ------------------------------------------------------------------------------
@@ -160,13 +149,30 @@ public:
     static constexpr int n3 = 32;
 
     static constexpr int l1Shift = 2;
-    Matrix<S16, inFeatures, n1> weight1;
+    union {
+        Matrix<S16, inFeatures, n1> weight1;  // First layer weights if !weight1S8
+        Matrix<S8, inFeatures, n1> weight1q;  // First layer weights if weight1S8
+    };
+    Vector<S16, n1> scale1;  // Per output scale factor for weight1q
     Vector<S16, n1> bias1;
 
     LayerData<n1*2, n2> lin2;
     LayerData<n2  , n3> lin3;
     LayerData<n3  , 1 > lin4;
 
+    /** If true, the first layer weight for input i and output j is
+     *  weight1q(i,j) * scale1(j). This halves the memory bandwidth needed
+     *  for incremental first layer updates. */
+    bool weight1S8 = false;
+
+    /** Get the first layer weight for input i and output j. */
+    int getWeight1(int i, int j) const;
+
+    /** Convert weight1 to 8-bit weights with one scale factor per output.
+     *  The scale factor for an output is the smallest value that makes all
+     *  weights for the output fit in 8 bits. */
+    void quantizeWeight1();
+
     /** Serialize this object to "os". */
     void save(std::ostream& os) const;
 
@@ -177,6 +183,20 @@ public:
     /** Prepare net for SIMD-optimized code. */
     void prepareMatMul();
 
+    /** Save this object as a network image file. The image contains the
+     *  weights in the layout produced by prepareMatMul(), so it can only be
+     *  used by programs using the same instruction set specific code.
+     *  @return False if the file could not be written. */
+    bool saveImage(const std::string& filename) const;
+
+    /** Map a network image file created by saveImage() read-only into memory.
+     *  The file contents are not copied, so all processes mapping the same
+     *  file share the same physical memory.
+     *  @return The network, or nullptr if the file could not be read, is
+     *          not compatible with this program, or if the weights do not
+     *          match the hash value stored in the file. */
+    static std::shared_ptr<const NetData> mapImage(const std::string& filename);
+
     /** Return a hash value corresponding to all data in this object. */
     U64 computeHash() const;
 
@@ -188,5 +208,12 @@ private:
     NetData(const NetData& other) = delete;
 };
 
+inline int
+NetData::getWeight1(int i, int j) const {
+    if (weight1S8)
+        return weight1q(i, j) * scale1(j);
+    return weight1(i, j);
+}
+
 
 #endif /* NNTYPES_HPP_ */
@@ -30,7 +30,7 @@
 #include "bitBoard.hpp"
 #include <type_traits>
 
-#ifdef HAS_AVX2
+#if defined(HAS_AVX2) || defined(HAS_AVX512)
 #include <immintrin.h>
 #endif
 #ifdef HAS_SSSE3
@@ -41,6 +41,12 @@
 #include <arm_neon.h>
 #endif
 
+#ifdef VECTOROP_NAMESPACE
+// Makes it possible to compile the functions in this file for several
+// instruction sets in the same program without violating the ODR.
+namespace VECTOROP_NAMESPACE {
+#endif
+
 // ------------------------------------------------------------------------------
 
 #ifdef HAS_AVX2
@@ -81,12 +87,49 @@ neon_hadd_32(int32x4_t sum) {
 
 #endif
 
+#ifdef HAS_AVX512
+
+/** Compute sum += a * b, where a is interpreted as 64 unsigned 8-bit values, b as 64
+ *  signed 8-bit values, and groups of 4 adjacent products are summed to 32-bit values.
+ *  Without VNNI the intermediate 16-bit sums can saturate, like in the AVX2 code. */
+inline __m512i
+avx512_dpbusd(__m512i sum, __m512i a, __m512i b) {
+#ifdef HAS_AVX512_VNNI
+    return _mm512_dpbusd_epi32(sum, a, b);
+#else
+    __m512i d = _mm512_maddubs_epi16(a, b); // d[i]=a[2i]*b[2i]+a[2i+1]*b[2i+1], requires a>=0
+    d = _mm512_madd_epi16(d, _mm512_set1_epi16(1)); // Pairwise sum of 16-bit values to 32-bit values
+    return _mm512_add_epi32(sum, d);
+#endif
+}
+
+#endif
+
 // ------------------------------------------------------------------------------
 
 /** Rearrange data in "weight" to be compatible with assumptions in matMul(). */
 template <int nIn, int nOut>
 void
 prepareMatMul(Matrix<S8,nOut,nIn>& weight) {
+#ifdef HAS_AVX512
+    if ((nIn % 8 == 0) && (nOut % 32) == 0) {
+        Matrix<S8,nOut,nIn> w2;
+        auto weight2 = [&w2](int i, int j) -> S8& {
+            int idx = j * 16 + i * nIn;
+            return w2(0, idx);
+        };
+        for (int i = 0; i < nOut; i += 16) {
+            for (int j = 0; j < nIn; j += 4) {
+                S8* start = &weight2(i, j);
+                for (int y = 0; y < 16; y++)
+                    for (int x = 0; x < 4; x++)
+                        *start++ = weight(i+y, j+x);
+            }
+        }
+        weight = w2;
+        return;
+    }
+#endif
 #ifdef HAS_AVX2
     if ((nIn % 8 == 0) && (nOut % 32) == 0) {
         Matrix<S8,nOut,nIn> w2;
@@ -152,6 +195,16 @@ prepareMatMul(Matrix<S8,nOut,nIn>& weight) {
 inline U64
 getNonZeroBlocks(const S8* v, int nElem) {
     U64 mask = 0;
+#ifdef HAS_AVX512
+    if ((nElem % 16) == 0) {
+        for (int e = 0; e < nElem; e += 16) {
+            __m512i val = _mm512_loadu_si512((const void*)&v[e*4]);
+            U64 m = _mm512_test_epi32_mask(val, val);
+            mask |= m << e;
+        }
+        return mask;
+    }
+#endif
 #ifdef HAS_AVX2
     if ((nElem % 8) == 0) {
         __m256i zero = _mm256_setzero_si256();
@@ -202,10 +255,57 @@ getNonZeroBlocks(const S8* v, int nElem) {
 }
 
 /** Compute result += weight * in, where "*" is matrix multiplication.
- * Note that the AVX2/SSSE3 implementations assume all elements in "in" are >= 0. */
+ * Note that the AVX512/AVX2/SSSE3 implementations assume all elements in "in" are >= 0. */
 template <bool sparse, int nIn, int nOut>
 inline void
 matMul(Vector<S32,nOut>& result, const Matrix<S8,nOut,nIn>& weight, const Vector<S8,nIn>& in) {
+#ifdef HAS_AVX512
+    if ((nIn % 8 == 0) && (nOut % 32) == 0) {
+        for (int i = 0; i < nOut; i += 32) {
+            __m512i sum1 = _mm512_loadu_si512((const void*)&result(i+16*0));
+            __m512i sum2 = _mm512_loadu_si512((const void*)&result(i+16*1));
+            auto process16x4 = [&](__m512i b, int i, int j, __m512i& sum) {
+                int idx = j * 16 + i * nIn;
+                __m512i a = _mm512_loadu_si512((const void*)&weight(0, idx));
+                sum = avx512_dpbusd(sum, b, a);       // Accumulate 16 sums
+            };
+            auto process32x4 = [&](int j) {
+                __m512i b = _mm512_set1_epi32(*(int*)&in(j+4*0));
+                process16x4(b, i+16*0, j+4*0, sum1);
+                process16x4(b, i+16*1, j+4*0, sum2);
+            };
+            if (sparse) {
+                for (int j0 = 0; j0 < nIn; j0 += 64*4) {
+                    U64 mask = getNonZeroBlocks(&in(j0), std::min(nIn - j0, 64));
+                    for (int k = BitUtil::bitCount(mask); k > 0; k--) {
+                        int j = j0 + BitUtil::extractBit(mask) * 4;
+                        process32x4(j);
+                    }
+                }
+            } else {
+                for (int j = 0; j < nIn; j += 8) {
+                    process32x4(j);
+                    process32x4(j+4);
+                }
+            }
+            _mm512_storeu_si512((void*)&result(i+16*0), sum1);
+            _mm512_storeu_si512((void*)&result(i+16*1), sum2);
+        }
+        return;
+    }
+    if (nIn % 64 == 0) {
+        for (int i = 0; i < nOut; i++) {
+            __m512i sum = _mm512_setzero_si512();
+            for (int j = 0; j < nIn; j += 64) {
+                __m512i a = _mm512_loadu_si512((const void*)&weight(i,j));
+                __m512i b = _mm512_loadu_si512((const void*)&in(j));
+                sum = avx512_dpbusd(sum, b, a);       // Accumulate 16 sums
+            }
+            result(i) += _mm512_reduce_add_epi32(sum); // Combine 16 32-bit values to one
+        }
+        return;
+    }
+#endif
 #ifdef HAS_AVX2
     if ((nIn % 8 == 0) && (nOut % 32) == 0) {
         __m256i ones16 = _mm256_set_epi16(1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1);
@@ -493,19 +593,21 @@ copyVec(Vector<T,nEnts>& dst, const Vector<T,nEnts>& src) {
 
 // ------------------------------------------------------------------------------
 
-template <int nIn, int nOut, bool sparse>
+/** Compute linOutput of a layer from input. */
+template <bool sparse, int nIn, int nOut>
 inline void
-Layer<nIn,nOut,sparse>::forward(const Vector<S8,nIn>& in, Output& out) {
-    evalLinear(in, out);
-    for (int i = 0; i < nOut; i++)
-        out.output(i) = static_cast<S8>(clamp(out.linOutput(i) >> 6, 0, 127));
+evalLinear(const LayerData<nIn,nOut>& data, const Vector<S8,nIn>& in, LayerOutput<nOut>& out) {
+    copyVec(out.linOutput, data.bias);
+    matMul<sparse>(out.linOutput, data.weight, in);
 }
 
-template <int nIn, int nOut, bool sparse>
+/** Compute output of a layer from input. */
+template <bool sparse, int nIn, int nOut>
 inline void
-Layer<nIn,nOut,sparse>::evalLinear(const Vector<S8,nIn>& in, Output& out) {
-    copyVec(out.linOutput, data.bias);
-    matMul<sparse>(out.linOutput, data.weight, in);
+forward(const LayerData<nIn,nOut>& data, const Vector<S8,nIn>& in, LayerOutput<nOut>& out) {
+    evalLinear<sparse>(data, in, out);
+    for (int i = 0; i < nOut; i++)
+        out.output(i) = static_cast<S8>(clamp(out.linOutput(i) >> 6, 0, 127));
 }
 
 // ------------------------------------------------------------------------------
@@ -516,6 +618,51 @@ void
 addSubWeights(Vector<S16, n1>& l1Out, const Matrix<S16, inFeatures, n1>& weight1,
               const int* toAdd, int toAddLen,
               const int* toSub, int toSubLen) {
+#ifdef HAS_AVX512
+    if (n1 % 256 == 0) {
+        for (int i = 0; i < n1; i += 256) {
+            __m512i s1 = _mm512_loadu_si512((const void*)&l1Out(i+32*0));
+            __m512i s2 = _mm512_loadu_si512((const void*)&l1Out(i+32*1));
+            __m512i s3 = _mm512_loadu_si512((const void*)&l1Out(i+32*2));
+            __m512i s4 = _mm512_loadu_si512((const void*)&l1Out(i+32*3));
+            __m512i s5 = _mm512_loadu_si512((const void*)&l1Out(i+32*4));
+            __m512i s6 = _mm512_loadu_si512((const void*)&l1Out(i+32*5));
+            __m512i s7 = _mm512_loadu_si512((const void*)&l1Out(i+32*6));
+            __m512i s8 = _mm512_loadu_si512((const void*)&l1Out(i+32*7));
+            for (int k = 0; k < toAddLen; k++) {
+                int idx = toAdd[k];
+                s1 = _mm512_add_epi16(s1, _mm512_loadu_si512((const void*)&weight1(idx, i+32*0)));
+                s2 = _mm512_add_epi16(s2, _mm512_loadu_si512((const void*)&weight1(idx, i+32*1)));
+                s3 = _mm512_add_epi16(s3, _mm512_loadu_si512((const void*)&weight1(idx, i+32*2)));
+                s4 = _mm512_add_epi16(s4, _mm512_loadu_si512((const void*)&weight1(idx, i+32*3)));
+                s5 = _mm512_add_epi16(s5, _mm512_loadu_si512((const void*)&weight1(idx, i+32*4)));
+                s6 = _mm512_add_epi16(s6, _mm512_loadu_si512((const void*)&weight1(idx, i+32*5)));
+                s7 = _mm512_add_epi16(s7, _mm512_loadu_si512((const void*)&weight1(idx, i+32*6)));
+                s8 = _mm512_add_epi16(s8, _mm512_loadu_si512((const void*)&weight1(idx, i+32*7)));
+            }
+            for (int k = 0; k < toSubLen; k++) {
+                int idx = toSub[k];
+                s1 = _mm512_sub_epi16(s1, _mm512_loadu_si512((const void*)&weight1(idx, i+32*0)));
+                s2 = _mm512_sub_epi16(s2, _mm512_loadu_si512((const void*)&weight1(idx, i+32*1)));
+                s3 = _mm512_sub_epi16(s3, _mm512_loadu_si512((const void*)&weight1(idx, i+32*2)));
+                s4 = _mm512_sub_epi16(s4, _mm512_loadu_si512((const void*)&weight1(idx, i+32*3)));
+                s5 = _mm512_sub_epi16(s5, _mm512_loadu_si512((const void*)&weight1(idx, i+32*4)));
+                s6 = _mm512_sub_epi16(s6, _mm512_loadu_si512((const void*)&weight1(idx, i+32*5)));
+                s7 = _mm512_sub_epi16(s7, _mm512_loadu_si512((const void*)&weight1(idx, i+32*6)));
+                s8 = _mm512_sub_epi16(s8, _mm512_loadu_si512((const void*)&weight1(idx, i+32*7)));
+            }
+            _mm512_storeu_si512((void*)&l1Out(i+32*0), s1);
+            _mm512_storeu_si512((void*)&l1Out(i+32*1), s2);
+            _mm512_storeu_si512((void*)&l1Out(i+32*2), s3);
+            _mm512_storeu_si512((void*)&l1Out(i+32*3), s4);
+            _mm512_storeu_si512((void*)&l1Out(i+32*4), s5);
+            _mm512_storeu_si512((void*)&l1Out(i+32*5), s6);
+            _mm512_storeu_si512((void*)&l1Out(i+32*6), s7);
+            _mm512_storeu_si512((void*)&l1Out(i+32*7), s8);
+        }
+        return;
+    }
+#endif
 #ifdef HAS_AVX2
     if (n1 % 128 == 0) {
         for (int i = 0; i < n1; i += 128) {
@@ -665,11 +812,214 @@ addSubWeights(Vector<S16, n1>& l1Out, const Matrix<S16, inFeatures, n1>& weight1
     }
 }
 
+/** Add/subtract rows of 8-bit "weight1" to/from "l1Out". */
+template <int n1, int inFeatures>
+void
+addSubWeights(Vector<S16, n1>& l1Out, const Matrix<S8, inFeatures, n1>& weight1,
+              const int* toAdd, int toAddLen,
+              const int* toSub, int toSubLen) {
+#ifdef HAS_AVX512
+    if (n1 % 256 == 0) {
+        for (int i = 0; i < n1; i += 256) {
+            __m512i s[8];
+            for (int j = 0; j < 8; j++)
+                s[j] = _mm512_loadu_si512((const void*)&l1Out(i+32*j));
+            for (int k = 0; k < toAddLen; k++) {
+                const S8* w = &weight1(toAdd[k], i);
+                for (int j = 0; j < 8; j++)
+                    s[j] = _mm512_add_epi16(s[j], _mm512_cvtepi8_epi16(_mm256_load_si256((const __m256i*)&w[32*j])));
+            }
+            for (int k = 0; k < toSubLen; k++) {
+                const S8* w = &weight1(toSub[k], i);
+                for (int j = 0; j < 8; j++)
+                    s[j] = _mm512_sub_epi16(s[j], _mm512_cvtepi8_epi16(_mm256_load_si256((const __m256i*)&w[32*j])));
+            }
+            for (int j = 0; j < 8; j++)
+                _mm512_storeu_si512((void*)&l1Out(i+32*j), s[j]);
+        }
+        return;
+    }
+#endif
+#ifdef HAS_AVX2
+    if (n1 % 128 == 0) {
+        for (int i = 0; i < n1; i += 128) {
+            __m256i s[8];
+            for (int j = 0; j < 8; j++)
+                s[j] = _mm256_load_si256((const __m256i*)&l1Out(i+16*j));
+            for (int k = 0; k < toAddLen; k++) {
+                const S8* w = &weight1(toAdd[k], i);
+                for (int j = 0; j < 8; j++)
+                    s[j] = _mm256_add_epi16(s[j], _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i*)&w[16*j])));
+            }
+            for (int k = 0; k < toSubLen; k++) {
+                const S8* w = &weight1(toSub[k], i);
+                for (int j = 0; j < 8; j++)
+                    s[j] = _mm256_sub_epi16(s[j], _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i*)&w[16*j])));
+            }
+            for (int j = 0; j < 8; j++)
+                _mm256_store_si256((__m256i*)&l1Out(i+16*j), s[j]);
+        }
+        return;
+    }
+#endif
+#ifdef HAS_SSSE3
+    if (n1 % 64 == 0) {
+        __m128i zero = _mm_setzero_si128();
+        for (int i = 0; i < n1; i += 64) {
+            __m128i s[8];
+            for (int j = 0; j < 8; j++)
+                s[j] = _mm_load_si128((const __m128i*)&l1Out(i+8*j));
+            for (int k = 0; k < toAddLen; k++) {
+                const S8* w = &weight1(toAdd[k], i);
+                for (int j = 0; j < 4; j++) {
+                    __m128i x = _mm_load_si128((const __m128i*)&w[16*j]);
+                    __m128i sign = _mm_cmpgt_epi8(zero, x);
+                    s[2*j+0] = _mm_add_epi16(s[2*j+0], _mm_unpacklo_epi8(x, sign));
+                    s[2*j+1] = _mm_add_epi16(s[2*j+1], _mm_unpackhi_epi8(x, sign));
+                }
+            }
+            for (int k = 0; k < toSubLen; k++) {
+                const S8* w = &weight1(toSub[k], i);
+                for (int j = 0; j < 4; j++) {
+                    __m128i x = _mm_load_si128((const __m128i*)&w[16*j]);
+                    __m128i sign = _mm_cmpgt_epi8(zero, x);
+                    s[2*j+0] = _mm_sub_epi16(s[2*j+0], _mm_unpacklo_epi8(x, sign));
+                    s[2*j+1] = _mm_sub_epi16(s[2*j+1], _mm_unpackhi_epi8(x, sign));
+                }
+            }
+            for (int j = 0; j < 8; j++)
+                _mm_store_si128((__m128i*)&l1Out(i+8*j), s[j]);
+        }
+        return;
+    }
+#endif
+#if defined(HAS_NEON) || defined(HAS_NEON_DOT)
+    if (n1 % 64 == 0) {
+        for (int i = 0; i < n1; i += 64) {
+            int16x8_t s[8];
+            for (int j = 0; j < 8; j++)
+                s[j] = vld1q_s16((const int16_t*)&l1Out(i+8*j));
+            for (int k = 0; k < toAddLen; k++) {
+                const S8* w = &weight1(toAdd[k], i);
+                for (int j = 0; j < 4; j++) {
+                    int8x16_t x = vld1q_s8((const int8_t*)&w[16*j]);
+                    s[2*j+0] = vaddw_s8(s[2*j+0], vget_low_s8(x));
+                    s[2*j+1] = vaddw_s8(s[2*j+1], vget_high_s8(x));
+                }
+            }
+            for (int k = 0; k < toSubLen; k++) {
+                const S8* w = &weight1(toSub[k], i);
+                for (int j = 0; j < 4; j++) {
+                    int8x16_t x = vld1q_s8((const int8_t*)&w[16*j]);
+                    s[2*j+0] = vsubw_s8(s[2*j+0], vget_low_s8(x));
+                    s[2*j+1] = vsubw_s8(s[2*j+1], vget_high_s8(x));
+                }
+            }
+            for (int j = 0; j < 8; j++)
+                vst1q_s16((int16_t*)&l1Out(i+8*j), s[j]);
+        }
+        return;
+    }
+#endif
+
+    // Generic fallback
+    for (int k = 0; k < toAddLen; k++) {
+        int idx = toAdd[k];
+        for (int i = 0; i < n1; i++)
+            l1Out(i) += weight1(idx, i);
+    }
+    for (int k = 0; k < toSubLen; k++) {
+        int idx = toSub[k];
+        for (int i = 0; i < n1; i++)
+            l1Out(i) -= weight1(idx, i);
+    }
+}
+
+/** Compute out = bias + l1Out * scale, using wrap-around 16-bit arithmetic.
+ *  Converts the first layer output for 8-bit weights to the same scale as
+ *  for 16-bit weights. */
+template <int n1>
+inline void
+scaleL1Out(Vector<S16, n1>& out, const Vector<S16, n1>& l1Out,
+           const Vector<S16, n1>& scale, const Vector<S16, n1>& bias) {
+#ifdef HAS_AVX512
+    if (n1 % 32 == 0) {
+        for (int i = 0; i < n1; i += 32) {
+            __m512i a = _mm512_loadu_si512((const void*)&l1Out(i));
+            __m512i s = _mm512_loadu_si512((const void*)&scale(i));
+            __m512i b = _mm512_loadu_si512((const void*)&bias(i));
+            _mm512_storeu_si512((void*)&out(i), _mm512_add_epi16(b, _mm512_mullo_epi16(a, s)));
+        }
+        return;
+    }
+#endif
+#ifdef HAS_AVX2
+    if (n1 % 16 == 0) {
+        for (int i = 0; i < n1; i += 16) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)&l1Out(i));
+            __m256i s = _mm256_loadu_si256((const __m256i*)&scale(i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)&bias(i));
+            _mm256_storeu_si256((__m256i*)&out(i), _mm256_add_epi16(b, _mm256_mullo_epi16(a, s)));
+        }
+        return;
+    }
+#endif
+#ifdef HAS_SSSE3
+    if (n1 % 8 == 0) {
+        for (int i = 0; i < n1; i += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)&l1Out(i));
+            __m128i s = _mm_loadu_si128((const __m128i*)&scale(i));
+            __m128i b = _mm_loadu_si128((const __m128i*)&bias(i));
+            _mm_storeu_si128((__m128i*)&out(i), _mm_add_epi16(b, _mm_mullo_epi16(a, s)));
+        }
+        return;
+    }
+#endif
+#if defined(HAS_NEON) || defined(HAS_NEON_DOT)
+    if (n1 % 8 == 0) {
+        for (int i = 0; i < n1; i += 8) {
+            int16x8_t a = vld1q_s16((const int16_t*)&l1Out(i));
+            int16x8_t s = vld1q_s16((const int16_t*)&scale(i));
+            int16x8_t b = vld1q_s16((const int16_t*)&bias(i));
+            vst1q_s16((int16_t*)&out(i), vmlaq_s16(b, a, s));
+        }
+        return;
+    }
+#endif
+
+    // Generic fallback
+    for (int i = 0; i < n1; i++)
+        out(i) = (S16)(U16)(bias(i) + l1Out(i) * scale(i));
+}
+
 // ------------------------------------------------------------------------------
 
 template <int shift, int n1>
 inline void
 scaleClipPack(S8* out, const Vector<S16, n1>& l1OutC) {
+#ifdef HAS_AVX512
+    if (n1 % 256 == 0) {
+        __m512i zero = _mm512_setzero_si512();
+        __m512i idx = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+        for (int i = 0; i < n1; i += 256) {
+            auto f = [&](int i) {
+                __m512i a = _mm512_loadu_si512((const void*)&l1OutC(i));
+                __m512i b = _mm512_loadu_si512((const void*)&l1OutC(i+32));
+                a = _mm512_srai_epi16(a, shift);
+                b = _mm512_srai_epi16(b, shift);
+                __m512i r = _mm512_packs_epi16(a, b);   // a0 b0 a1 b1 a2 b2 a3 b3
+                r = _mm512_max_epi8(r, zero);
+                r = _mm512_permutex2var_epi64(r, idx, r);
+                _mm512_storeu_si512((void*)&out[i], r);
+            };
+            f(i+64*0);
+            f(i+64*1);
+            f(i+64*2);
+            f(i+64*3);
+        }
+        return;
+    }
+#endif
 #ifdef HAS_AVX2
     if (n1 % 128 == 0) {
         __m256i zero = _mm256_set1_epi8(0);
@@ -742,4 +1092,8 @@ scaleClipPack(S8* out, const Vector<S16, n1>& l1OutC) {
         out[i] = clamp(l1OutC(i) >> shift, 0, 127);
 }
 
+#ifdef VECTOROP_NAMESPACE
+}
+#endif
+
 #endif /* VECTOROP_HPP_ */
@@ -31,12 +31,18 @@ namespace UciParams {
     using CheckParam = Parameters::CheckParam;
     using StringParam = Parameters::StringParam;
     using ButtonParam = Parameters::ButtonParam;
+    using ComboParam = Parameters::ComboParam;
 #ifdef CLUSTER
     int maxThreads = 64*1024*1024;
 #else
     int maxThreads = 512;
 #endif
     std::shared_ptr<SpinParam> threads(std::make_shared<SpinParam>("Threads", 1, maxThreads, 1));
+    std::shared_ptr<SpinParam> threadSpinWait(std::make_shared<SpinParam>("ThreadSpinWait", 0, 100000, 0));
+    std::shared_ptr<ComboParam> smpMode(std::make_shared<ComboParam>("SMPMode",
+                                                                     std::vector<std::string>{"Jobs", "Lazy"},
+                                                                     "Jobs"));
+    std::shared_ptr<CheckParam> deterministic(std::make_shared<CheckParam>("Deterministic", false));
 
     std::shared_ptr<SpinParam> hash(std::make_shared<SpinParam>("Hash", 1, 1024*1024, 16));
     std::shared_ptr<SpinParam> multiPV(std::make_shared<SpinParam>("MultiPV", 1, 256, 1));
@@ -49,6 +55,12 @@ namespace UciParams {
     std::shared_ptr<CheckParam> useNullMove(std::make_shared<CheckParam>("UseNullMove", true));
     std::shared_ptr<CheckParam> analysisAgeHash(std::make_shared<CheckParam>("AnalysisAgeHash", true));
     std::shared_ptr<ButtonParam> clearHash(std::make_shared<ButtonParam>("Clear Hash"));
+    std::shared_ptr<StringParam> hashFile(std::make_shared<StringParam>("HashFile", ""));
+    std::shared_ptr<ButtonParam> saveHash(std::make_shared<ButtonParam>("Save Hash"));
+    std::shared_ptr<ButtonParam> loadHash(std::make_shared<ButtonParam>("Load Hash"));
+    std::shared_ptr<CheckParam> hashStats(std::make_shared<CheckParam>("HashStats", false));
+
+    std::shared_ptr<StringParam> evalFile(std::make_shared<StringParam>("EvalFile", ""));
 
     std::shared_ptr<SpinParam> strength(std::make_shared<SpinParam>("Strength", 0, 1000, 1000));
     std::shared_ptr<SpinParam> maxNPS(std::make_shared<SpinParam>("MaxNPS", 0, 10000000, 0));
@@ -135,6 +147,9 @@ Parameters::Parameters() {
     addPar(std::make_shared<StringParam>("UCI_EngineAbout", about));
 
     addPar(UciParams::threads);
+    addPar(UciParams::threadSpinWait);
+    addPar(UciParams::smpMode);
+    addPar(UciParams::deterministic);
 
     addPar(UciParams::hash);
     addPar(UciParams::multiPV);
@@ -147,6 +162,12 @@ Parameters::Parameters() {
     addPar(UciParams::useNullMove);
     addPar(UciParams::analysisAgeHash);
     addPar(UciParams::clearHash);
+    addPar(UciParams::hashFile);
+    addPar(UciParams::saveHash);
+    addPar(UciParams::loadHash);
+    addPar(UciParams::hashStats);
+
+    addPar(UciParams::evalFile);
 
     addPar(UciParams::strength);
     addPar(UciParams::maxNPS);
@@ -345,6 +345,9 @@ Parameters::set(const std::string& name, const std::string& value) {
 
 namespace UciParams {
     extern std::shared_ptr<Parameters::SpinParam> threads;
+    extern std::shared_ptr<Parameters::SpinParam> threadSpinWait; // Microseconds to spin before sleeping
+    extern std::shared_ptr<Parameters::ComboParam> smpMode;        // "Jobs" or "Lazy"
+    extern std::shared_ptr<Parameters::CheckParam> deterministic;  // Reproducible multi-threaded search
 
     extern std::shared_ptr<Parameters::SpinParam> hash;
     extern std::shared_ptr<Parameters::SpinParam> multiPV;
@@ -357,6 +360,12 @@ namespace UciParams {
     extern std::shared_ptr<Parameters::CheckParam> useNullMove;
     extern std::shared_ptr<Parameters::CheckParam> analysisAgeHash;
     extern std::shared_ptr<Parameters::ButtonParam> clearHash;
+    extern std::shared_ptr<Parameters::StringParam> hashFile;
+    extern std::shared_ptr<Parameters::ButtonParam> saveHash;
+    extern std::shared_ptr<Parameters::ButtonParam> loadHash;
+    extern std::shared_ptr<Parameters::CheckParam> hashStats;
+
+    extern std::shared_ptr<Parameters::StringParam> evalFile;
 
     extern std::shared_ptr<Parameters::SpinParam> strength;
     extern std::shared_ptr<Parameters::SpinParam> maxNPS;
@@ -0,0 +1,153 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * perft.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#include "perft.hpp"
+#include "moveGen.hpp"
+#include "textio.hpp"
+#include "timeUtil.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <iostream>
+
+Perft::Perft(int nThreads, int hashMB)
+    : nThreads(std::max(nThreads, 1)) {
+    if (hashMB > 0) {
+        U64 nEntries = 1;
+        while (nEntries * 2 * sizeof(HashEntry) <= (U64)hashMB * 1024 * 1024)
+            nEntries *= 2;
+        hashTable = std::vector<HashEntry>(nEntries);
+        for (HashEntry& ent : hashTable) {
+            ent.key.store(0, std::memory_order_relaxed);
+            ent.data.store(0, std::memory_order_relaxed);
+        }
+        hashMask = nEntries - 1;
+    }
+}
+
+U64
+Perft::compute(const Position& pos, int depth, std::vector<MoveCount>* divide) {
+    if (divide)
+        divide->clear();
+    if (depth <= 0)
+        return 1;
+
+    MoveList moves;
+    MoveGen::legalMoves(pos, moves);
+    std::vector<U64> nodes(moves.size, 1);
+
+    if (depth > 1) {
+        std::atomic<int> nextMove(0);
+        auto worker = [&]() {
+            Position myPos(pos);
+            UndoInfo ui;
+            while (true) {
+                int mi = nextMove.fetch_add(1);
+                if (mi >= moves.size)
+                    break;
+                myPos.makeMove(moves[mi], ui);
+                nodes[mi] = perft(myPos, depth - 1);
+                myPos.unMakeMove(moves[mi], ui);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int i = 1; i < std::min(nThreads, moves.size); i++)
+            threads.emplace_back(worker);
+        worker();
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    U64 sum = 0;
+    for (int mi = 0; mi < moves.size; mi++) {
+        sum += nodes[mi];
+        if (divide)
+            divide->push_back(MoveCount{moves[mi], nodes[mi]});
+    }
+    return sum;
+}
+
+U64
+Perft::report(const Position& pos, int depth, std::ostream& os) {
+    std::vector<MoveCount> divide;
+    S64 t0 = currentTimeMillis();
+    U64 nodes = compute(pos, depth, &divide);
+    S64 t = currentTimeMillis() - t0;
+    for (const MoveCount& mc : divide)
+        os << TextIO::moveToUCIString(mc.move) << ": " << mc.nodes << '\n';
+    U64 nps = t > 0 ? nodes * 1000 / t : 0;
+    os << "Total time (ms) : " << t << '\n';
+    os << "Nodes searched  : " << nodes << '\n';
+    os << "Nodes/second    : " << nps << std::endl;
+    return nodes;
+}
+
+U64
+Perft::perft(Position& pos, int depth) {
+    MoveList moves;
+    if (depth == 1) {
+        MoveGen::legalMoves(pos, moves);
+        return moves.size;
+    }
+
+    const U64 key = pos.zobristHash();
+    U64 nodes;
+    if (probe(key, depth, nodes))
+        return nodes;
+
+    MoveGen::legalMoves(pos, moves);
+    nodes = 0;
+    UndoInfo ui;
+    for (int mi = 0; mi < moves.size; mi++) {
+        const Move& m = moves[mi];
+        pos.makeMove(m, ui);
+        nodes += perft(pos, depth - 1);
+        pos.unMakeMove(m, ui);
+    }
+    store(key, depth, nodes);
+    return nodes;
+}
+
+bool
+Perft::probe(U64 key, int depth, U64& nodes) const {
+    if (hashTable.empty())
+        return false;
+    const HashEntry& ent = hashTable[key & hashMask];
+    U64 data = ent.data.load(std::memory_order_relaxed);
+    if ((ent.key.load(std::memory_order_relaxed) ^ data) != key || (int)(data & 0xff) != depth)
+        return false;
+    nodes = data >> 8;
+    return true;
+}
+
+void
+Perft::store(U64 key, int depth, U64 nodes) {
+    if (hashTable.empty())
+        return;
+    HashEntry& ent = hashTable[key & hashMask];
+    U64 data = (nodes << 8) | depth;
+    ent.key.store(key ^ data, std::memory_order_relaxed);
+    ent.data.store(data, std::memory_order_relaxed);
+}
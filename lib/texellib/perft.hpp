@@ -0,0 +1,80 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * perft.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef PERFT_HPP_
+#define PERFT_HPP_
+
+#include "position.hpp"
+#include "move.hpp"
+
+#include <atomic>
+#include <vector>
+#include <iosfwd>
+
+/**
+ * Multi-threaded perft computation. The root moves are distributed over
+ * the threads, and sub-tree node counts are stored in a hash table shared
+ * by all threads. The last ply is counted in bulk by generating legal moves.
+ */
+class Perft {
+public:
+    /** Create a perft computer using "nThreads" threads and a hash table of
+     *  size "hashMB" megabytes. If hashMB is 0, no hash table is used. */
+    Perft(int nThreads, int hashMB);
+
+    /** Node count for one root move. */
+    struct MoveCount {
+        Move move;
+        U64 nodes;
+    };
+
+    /** Compute perft(depth) for "pos". If "divide" is not null, it is set
+     *  to the node count for each legal root move. */
+    U64 compute(const Position& pos, int depth, std::vector<MoveCount>* divide = nullptr);
+
+    /** Compute perft(depth) for "pos". Print the node count for each root
+     *  move, followed by the total node count, elapsed time and speed. */
+    U64 report(const Position& pos, int depth, std::ostream& os);
+
+private:
+    /** Compute perft(depth) for "pos", depth >= 1. */
+    U64 perft(Position& pos, int depth);
+
+    bool probe(U64 key, int depth, U64& nodes) const;
+    void store(U64 key, int depth, U64 nodes);
+
+    /** Lockless hash entry. "key" contains the position hash xor:ed with
+     *  "data", so entries torn by concurrent writes are detected by probe(). */
+    struct HashEntry {
+        std::atomic<U64> key;
+        std::atomic<U64> data; // (nodes << 8) | depth
+    };
+
+    const int nThreads;
+    std::vector<HashEntry> hashTable;
+    U64 hashMask = 0;
+};
+
+#endif /* PERFT_HPP_ */
@@ -35,8 +35,9 @@
 const U64 hashEmpty = 0x5fd230cc43568439ULL;
 
 SqTbl<U8> Position::castleSqMask;
-
-static StaticInitializer<Position> posInit;
+const int Position::cuckooSize;
+U64 Position::cuckooKeys[cuckooSize];
+U16 Position::cuckooMoves[cuckooSize];
 
 void
 Position::staticInitialize() {
@@ -49,6 +50,48 @@ Position::staticInitialize() {
     castleSqMask[A8] &= ~(1 << A8_CASTLE);
     castleSqMask[E8] &= ~((1 << A8_CASTLE) | (1 << H8_CASTLE));
     castleSqMask[H8] &= ~(1 << H8_CASTLE);
+
+    initCuckoo();
+}
+
+void
+Position::initCuckoo() {
+    for (int i = 0; i < cuckooSize; i++) {
+        cuckooKeys[i] = 0;
+        cuckooMoves[i] = 0;
+    }
+    auto canMove = [](int pType, int dx, int dy) -> bool {
+        dx = std::abs(dx);
+        dy = std::abs(dy);
+        switch (pType) {
+        case Piece::WKING:   return std::max(dx, dy) == 1;
+        case Piece::WQUEEN:  return (dx == 0) || (dy == 0) || (dx == dy);
+        case Piece::WROOK:   return (dx == 0) || (dy == 0);
+        case Piece::WBISHOP: return dx == dy;
+        case Piece::WKNIGHT: return std::min(dx, dy) == 1 && std::max(dx, dy) == 2;
+        default:             return false;
+        }
+    };
+    for (int p = Piece::WKING; p <= Piece::BPAWN; p++) {
+        for (int s1 = 0; s1 < 64; s1++) {
+            for (int s2 = s1 + 1; s2 < 64; s2++) {
+                int dx = Square(s2).getX() - Square(s1).getX();
+                int dy = Square(s2).getY() - Square(s1).getY();
+                if (!canMove(Piece::makeWhite(p), dx, dy))
+                    continue;
+                U64 key = psHashKeys[p][Square(s1)] ^ psHashKeys[p][Square(s2)] ^ whiteHashKey;
+                U16 move = s1 + 64 * s2; // Never 0, since s1 < s2
+                int idx = cuckooH1(key);
+                while (true) {
+                    std::swap(cuckooKeys[idx], key);
+                    std::swap(cuckooMoves[idx], move);
+                    if (move == 0)
+                        break;
+                    idx = (idx == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                }
+            }
+        }
+    }
 }
 
 Position::Position() {
@@ -792,3 +835,6 @@ const U64 Position::moveCntKeys[101] = {
     0xce22f3b15bbca65dULL, 0xff839edc88ee6833ULL, 0x9b944c8fbaffbe94ULL, 0x4dcf12e95dbf59d8ULL,
     0xd4e8006c8265fa6dULL
 };
+
+// Must be after the hash key definitions, which are dynamically initialized.
+static StaticInitializer<Position> posInit;
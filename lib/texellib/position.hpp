@@ -235,6 +235,14 @@ public:
     /** Get hash key for a piece at a square. */
     static U64 getHashKey(int piece, Square square);
 
+    /**
+     * Return true if keyDiff is the zobrist hash difference caused by a reversible
+     * non-pawn move, i.e. a move that could be undone by moving the piece back.
+     * If so, the squares of the move are stored in s1 and s2. The direction of
+     * the move is not known, so the piece can be on either of the two squares.
+     */
+    static bool getCuckooMove(U64 keyDiff, Square& s1, Square& s2);
+
 
     /** Serialization. Used by tree logging code. */
     struct SerializeData {
@@ -262,6 +270,15 @@ private:
     const static U64 castleHashKeys[16];   // [castleMask]
     const static U64 epHashKeys[9];        // [epFile + 1] (epFile==-1 for no ep)
     const static U64 moveCntKeys[101];     // [min(halfMoveClock, 100)]
+
+    /** Cuckoo hash tables containing the hash key difference for all reversible
+     *  non-pawn moves on an empty board, and the corresponding move squares. */
+    static const int cuckooSize = 8192;
+    static U64 cuckooKeys[cuckooSize];
+    static U16 cuckooMoves[cuckooSize];    // from + 64 * to
+    static int cuckooH1(U64 key) { return key & (cuckooSize - 1); }
+    static int cuckooH2(U64 key) { return (key >> 16) & (cuckooSize - 1); }
+    static void initCuckoo();
 };
 
 /** For debugging. */
@@ -625,4 +642,18 @@ inline U64 Position::getHashKey(int piece, Square square) {
     return psHashKeys[piece][square];
 }
 
+inline bool
+Position::getCuckooMove(U64 keyDiff, Square& s1, Square& s2) {
+    int idx = cuckooH1(keyDiff);
+    if (cuckooKeys[idx] != keyDiff) {
+        idx = cuckooH2(keyDiff);
+        if (cuckooKeys[idx] != keyDiff)
+            return false;
+    }
+    int m = cuckooMoves[idx];
+    s1 = Square(m & 63);
+    s2 = Square(m >> 6);
+    return true;
+}
+
 #endif /* POSITION_HPP_ */
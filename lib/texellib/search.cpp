@@ -139,6 +139,13 @@ Search::iterativeDeepening(const MoveList& scMovesIn,
     ht.reScale();
     comm.sendInitSearch(pos, posHashList, posHashListSize, clearHistory,
                         eval.getWhiteContempt());
+    lazySMP = UciParams::smpMode->getStringPar() == "Lazy";
+    if (lazySMP) {
+        // An empty current move makes helper threads search from the root position
+        SearchTreeInfo sti;
+        jobId++;
+        comm.sendStartSearch(jobId, sti, -MATE0, MATE0, maxDepth);
+    }
 
     int posHashFirstNew0 = posHashFirstNew;
     bool knownLoss = false; // True if at least one of the first maxPV moves is a known loss
@@ -318,6 +325,9 @@ private:
 int
 Search::negaScoutRoot(bool tb, int alpha, int beta, int ply, int depth,
                       const bool inCheck) {
+    if (lazySMP)
+        return negaScout(tb, alpha, beta, ply, depth, Square(-1), inCheck);
+
     SearchTreeInfo sti = searchTreeInfo[ply-1];
     jobId++;
     comm.sendStartSearch(jobId, sti, alpha, beta, depth);
@@ -440,6 +450,7 @@ Search::shouldStop() {
     private:
         int jobId;
     };
+    DeterministicScheduler::instance().yield(threadNo);
     Handler handler(jobId);
     comm.poll(handler);
 
@@ -495,8 +506,7 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
     if (canClaimDraw50(pos)) {
         if (inCheck) {
             MoveList moves;
-            MoveGen::pseudoLegalMoves(pos, moves);
-            MoveGen::removeIllegal(pos, moves);
+            MoveGen::legalMoves(pos, moves);
             if (moves.size == 0) {            // Can't claim draw if already check mated.
                 int score = -(MATE0-(ply+1));
                 logFile.logNodeEnd(searchTreeInfo[ply].nodeIdx, score, TType::T_EXACT, UNKNOWN_SCORE, hKey);
@@ -511,6 +521,13 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
         return 0;            // No need to test for mate here, since it would have been
                              // discovered the first time the position came up.
     }
+    if ((alpha < 0) && hasUpcomingRep(pos, posHashList, posHashListSize, posHashFirstNew)) {
+        alpha = 0;           // Side to move can force a repetition
+        if (alpha >= beta) {
+            logFile.logNodeEnd(searchTreeInfo[ply].nodeIdx, alpha, TType::T_GE, UNKNOWN_SCORE, hKey);
+            return alpha;
+        }
+    }
 
     // Check transposition table
     int evalScore = UNKNOWN_SCORE;
@@ -538,6 +555,7 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
         bool excl = sti.abdadaExclusive;
         sti.abdadaExclusive = false;
         if (excl && ent.getBusy()) {
+            TranspositionTable::Stats::inc(tt.getStats().busyHits);
             logFile.logNodeEnd(sti.nodeIdx, BUSY, TType::T_EMPTY, UNKNOWN_SCORE, hKey);
             return BUSY;
         }
@@ -769,18 +787,20 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
         }
     }
 
-    // Generate move list
+    // Start the move list with the hash move. The remaining moves are
+    // generated in stages by nextMoveStage() when they are needed.
     MoveList moves;
-    if (inCheck)
-        MoveGen::checkEvasions(pos, moves);
-    else
-        MoveGen::pseudoLegalMoves(pos, moves);
-    bool seeDone = false;
-    bool hashMoveSelected = true;
-    if (hashMove.isEmpty() || !selectHashMove(moves, hashMove)) {
-        scoreMoveList(moves, ply);
-        seeDone = true;
-        hashMoveSelected = false;
+    MoveStages stages(inCheck);
+    bool hashMoveSelected = false;
+    if (!hashMove.isEmpty()) {
+        if (MoveGen::isPseudoLegal(pos, hashMove)) {
+            moves.addMove(hashMove.from(), hashMove.to(), hashMove.promoteTo());
+            moves[0].setScore(10000);
+            stages.hashMove = hashMove;
+            hashMoveSelected = true;
+        } else {
+            TranspositionTable::Stats::inc(tt.getStats().collisions);
+        }
     }
 
     // Handle singular extension
@@ -849,6 +869,8 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
     int bestScore = illegalScore;
     int bestMove = -1;
     int lmrCount = 0;
+    int prev1, prev2;
+    getHistContext(ply, prev1, prev2);
     if (tb && tbScore != illegalScore) {
         bestScore = tbScore - 1;
         bestMove = -2;
@@ -857,17 +879,18 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
     bool allDone = false;
     for (int pass = 0; pass < 2 && !allDone; pass++) {
         allDone = true;
-        for (int mi = 0; mi < moves.size; mi++) {
+        for (int mi = 0; mi < moves.size || (pass == 0 && nextMoveStage(moves, stages, ply)); mi++) {
             if (pass > 0 && moves[mi].score() > BUSY)
                 continue;
             if (pass == 0) {
-                if ((mi == 1) && !seeDone) {
-                    scoreMoveList(moves, ply, 1);
-                    seeDone = true;
-                }
-                if ((mi < lmpMoveCountLimit) || (depth >= 2 && lmrCount <= lmrMoveCountLimit1))
-                    if ((mi > 0) || !hashMoveSelected)
+                if ((mi < lmpMoveCountLimit) || (depth >= 2 && lmrCount <= lmrMoveCountLimit1)) {
+                    if ((mi > 0) || !hashMoveSelected) {
                         selectBest(moves, mi);
+                        // Search losing captures after killers and quiet moves
+                        while (moves[mi].score() < 0 && nextMoveStage(moves, stages, ply))
+                            selectBest(moves, mi);
+                    }
+                }
             }
             Move& m = moves[mi];
             bool isCapture = (pos.getPiece(m.to()) != Piece::EMPTY);
@@ -913,6 +936,8 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
                         }
                         if ((lmr > 0) && !isCapture && defenseMove(pos, m))
                             lmr = 0;
+                        if ((lmr > 1) && !isCapture && ht.isCounterMove(prev1, m))
+                            lmr--; // Counter moves are often good replies
                         if ((lmr > 0) && (lmr + 3 <= depth) && (beta == alpha + 1)) {
                             if (!expectedCutNodeComputed) {
                                 expectedCutNode = isExpectedCutNode(ply);
@@ -988,12 +1013,21 @@ Search::negaScout(int alpha, int beta, int ply, int depth, Square recaptureSquar
             if (alpha >= beta) {
                 if (pos.getPiece(m.to()) == Piece::EMPTY) {
                     kt.addKiller(ply, m);
-                    ht.addSuccess(pos, m, depth);
+                    ht.addSuccess(pos, m, depth, prev1, prev2);
+                    ht.setCounterMove(prev1, m);
                     for (int mi2 = mi - 1; mi2 >= 0; mi2--) {
                         Move m2 = moves[mi2];
                         if (pos.getPiece(m2.to()) == Piece::EMPTY)
                             if (m2.score() > BUSY)
-                                ht.addFail(pos, m2, depth);
+                                ht.addFail(pos, m2, depth, prev1, prev2);
+                    }
+                } else {
+                    ht.addCaptureSuccess(pos, m, depth);
+                    for (int mi2 = mi - 1; mi2 >= 0; mi2--) {
+                        Move m2 = moves[mi2];
+                        if (pos.getPiece(m2.to()) != Piece::EMPTY)
+                            if (m2.score() > BUSY)
+                                ht.addCaptureFail(pos, m2, depth);
                     }
                 }
                 if (((ent.getType() == TType::T_EXACT || ent.getType() == TType::T_LE)) &&
@@ -1078,8 +1112,7 @@ Search::getRootMoves(const MoveList& rootMovesIn,
     MoveList rootMoves(rootMovesIn);
     if ((maxTimeMillis >= 0) || (maxNodes >= 0) || (maxDepth >= 0)) {
         MoveList legalMoves;
-        MoveGen::pseudoLegalMoves(pos, legalMoves);
-        MoveGen::removeIllegal(pos, legalMoves);
+        MoveGen::legalMoves(pos, legalMoves);
         if (rootMoves.size == legalMoves.size) {
             // Game mode, handle missing TBs
             std::vector<Move> movesToSearch;
@@ -1222,6 +1255,7 @@ Search::quiesce(int alpha, int beta, int ply, int depth, const bool inCheck) {
     }
     scoreMoveListMvvLva(moves);
     UndoInfo ui;
+    U64 searchedCaptures = 0; // Bit mask of searched captures among the first 64 moves
     for (int mi = 0; mi < moves.size; mi++) {
         if (mi < quiesceMaxSortMoves) {
             // If the first N moves didn't fail high this is probably an ALL-node,
@@ -1284,6 +1318,7 @@ Search::quiesce(int alpha, int beta, int ply, int depth, const bool inCheck) {
         nodesToGo--;
         score = -quiesce(-beta, -alpha, ply + 1, depth - 1, nextInCheck);
         pos.unMakeMove(m, ui);
+        const bool isCapture = (pos.getPiece(m.to()) != Piece::EMPTY);
         if (score > bestScore) {
             bestScore = score;
             if (score > alpha) {
@@ -1292,10 +1327,19 @@ Search::quiesce(int alpha, int beta, int ply, int depth, const bool inCheck) {
                     sti.bestMove.setMove(m.from(), m.to(), m.promoteTo(), score);
                 }
                 alpha = score;
-                if (alpha >= beta)
+                if (alpha >= beta) {
+                    if (isCapture) {
+                        ht.addCaptureSuccess(pos, m, depth);
+                        for (int mi2 = std::min(mi, 64) - 1; mi2 >= 0; mi2--)
+                            if (searchedCaptures & (1ULL << mi2))
+                                ht.addCaptureFail(pos, moves[mi2], depth);
+                    }
                     return alpha;
+                }
             }
         }
+        if (isCapture && (mi < 64))
+            searchedCaptures |= 1ULL << mi;
     }
     return bestScore;
 }
@@ -1421,7 +1465,7 @@ Search::quiescePos(int alpha, int beta, int ply, int depth, const bool inCheck)
 }
 
 int
-Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
+Search::SEE(const Position& pos, const Move& m, int alpha, int beta) {
     int captures[64];   // Value of captured pieces
     const int kV = ::kV;
 
@@ -1433,11 +1477,21 @@ Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
     }
     int nCapt = 1;                  // Number of entries in captures[]
 
-    UndoInfo ui;
-    pos.makeSEEMove(m, ui);
-    bool white = pos.isWhiteMove();
-    int valOnSquare = ::pieceValue[pos.getPiece(square)];
-    U64 occupied = pos.occupiedBB();
+    // Play the first move on a local occupancy bitboard. Pieces that have been
+    // removed from "occupied" are ignored, so the piece type bitboards in pos
+    // can be used unmodified. Sliding attackers hidden behind captured pieces
+    // are found because attacks are recomputed from "occupied" in every step.
+    const int p = pos.getPiece(m.from());
+    U64 occupied = pos.occupiedBB() & ~(1ULL << m.from());
+    if (square == pos.getEpSquare()) {
+        if (p == Piece::WPAWN)
+            occupied &= ~(1ULL << (square - 8));
+        else if (p == Piece::BPAWN)
+            occupied &= ~(1ULL << (square + 8));
+    }
+    occupied |= 1ULL << square;
+    bool white = !pos.isWhiteMove();
+    int valOnSquare = ::pieceValue[p];
     int currScore = -captures[0];
     int tmp = alpha; alpha = -beta; beta = -tmp;
     while (true) {
@@ -1524,7 +1578,6 @@ Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
         occupied &= ~(atk & -atk);
         white = !white;
     }
-    pos.unMakeSEEMove(m, ui);
 
     int score = 0;
     for (int i = nCapt - 1; i > 0; i--)
@@ -1532,8 +1585,21 @@ Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
     return captures[0] - score;
 }
 
+void
+Search::scoreMoveListMvvLva(MoveList& moves) const {
+    for (int i = 0; i < moves.size; i++) {
+        Move& m = moves[i];
+        int v = pos.getPiece(m.to());
+        int a = pos.getPiece(m.from());
+        int hs = ht.getCaptureHistScore(pos, m);
+        m.setScore(Evaluate::pieceValueOrder[v] * 64 + hs - Evaluate::pieceValueOrder[a]);
+    }
+}
+
 void
 Search::scoreMoveList(MoveList& moves, int ply, int startIdx) {
+    int prev1, prev2;
+    getHistContext(ply, prev1, prev2);
     for (int i = startIdx; i < moves.size; i++) {
         Move& m = moves[i];
         bool isCapture = (pos.getPiece(m.to()) != Piece::EMPTY) || (m.promoteTo() != Piece::EMPTY);
@@ -1549,13 +1615,15 @@ Search::scoreMoveList(MoveList& moves, int ply, int startIdx) {
                 score += 50;
             else
                 score -= 50;
-            score *= 100;
+            score = score * 100 + ht.getCaptureHistScore(pos, m);
         } else {
             int ks = kt.getKillerScore(ply, m);
             if (ks > 0) {
                 score += ks + 50;
             } else {
-                int hs = ht.getHistScore(pos, m);
+                int hs = ht.getHistScore(pos, m, prev1, prev2);
+                if ((hs < 29) && ht.isCounterMove(prev1, m))
+                    hs = 29; // Order early, but keep it eligible for LMR in negaScout
                 score += hs;
             }
         }
@@ -1563,6 +1631,80 @@ Search::scoreMoveList(MoveList& moves, int ply, int startIdx) {
     }
 }
 
+/** Remove move "m" from moves[first,moves.size), if present. */
+static inline void
+removeMove(MoveList& moves, int first, const Move& m) {
+    for (int i = first; i < moves.size; i++) {
+        if (moves[i] == m) {
+            moves[i] = moves[--moves.size];
+            return;
+        }
+    }
+}
+
+bool
+Search::nextMoveStage(MoveList& moves, MoveStages& ms, int ply) {
+    while (ms.stage != STAGE_DONE) {
+        const int first = moves.size;
+        switch (ms.stage) {
+        case STAGE_CAPTURES:
+            MoveGen::pseudoLegalCaptures(pos, moves);
+            removeMove(moves, first, ms.hashMove);
+            ms.stage = STAGE_KILLERS;
+            break;
+        case STAGE_KILLERS:
+            for (int i = 0; i < 2; i++) {
+                Move m = kt.getKiller(ply, i);
+                if (m.isEmpty() || m == ms.hashMove || m.promoteTo() != Piece::EMPTY ||
+                    pos.getPiece(m.to()) != Piece::EMPTY)
+                    continue;
+                int p = pos.getPiece(m.from());
+                if ((p == Piece::WPAWN || p == Piece::BPAWN) && m.from().getX() != m.to().getX())
+                    continue; // En passant, already generated as a capture
+                if (!MoveGen::isPseudoLegal(pos, m))
+                    continue;
+                moves.addMove(m.from(), m.to(), Piece::EMPTY);
+                ms.killers[ms.nKillers++] = m;
+            }
+            ms.stage = STAGE_QUIETS;
+            break;
+        case STAGE_QUIETS:
+            MoveGen::pseudoLegalNonCaptures(pos, moves);
+            removeMove(moves, first, ms.hashMove);
+            for (int i = 0; i < ms.nKillers; i++)
+                removeMove(moves, first, ms.killers[i]);
+            ms.stage = STAGE_DONE;
+            break;
+        case STAGE_EVASIONS:
+            MoveGen::checkEvasions(pos, moves);
+            removeMove(moves, first, ms.hashMove);
+            ms.stage = STAGE_DONE;
+            break;
+        case STAGE_DONE:
+            break;
+        }
+        if (moves.size > first) {
+            scoreMoveList(moves, ply, first);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+Search::getHistContext(int ply, int& prev1, int& prev2) const {
+    prev1 = prev2 = -1;
+    if (ply < 1)
+        return;
+    const Move& m1 = searchTreeInfo[ply-1].currentMove;
+    prev1 = History::getContext(pos, m1);
+    if (ply < 2)
+        return;
+    const Move& m2 = searchTreeInfo[ply-2].currentMove;
+    if (m2.to() != m1.to()) // Else the piece that made move m2 has been captured
+        prev2 = History::getContext(pos, m2);
+}
+
 bool
 Search::selectHashMove(MoveList& moves, const Move& hashMove) {
     for (int i = 0; i < moves.size; i++) {
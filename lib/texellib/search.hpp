@@ -138,6 +138,11 @@ public:
     static bool canClaimDrawRep(const Position& pos, const std::vector<U64>& posHashList,
                                 int posHashListSize, int posHashFirstNew);
 
+    /** Return true if the side to move can play a reversible move that repeats
+     *  a position searched earlier in the current search tree. */
+    static bool hasUpcomingRep(const Position& pos, const std::vector<U64>& posHashList,
+                               int posHashListSize, int posHashFirstNew);
+
     /**
      * Compute scores for each move in a move list, using SEE, killer and history information.
      * @param moves  List of moves to score.
@@ -154,10 +159,10 @@ public:
     S64 getTbHitsThisThread() const;
 
     /**
-     * Static exchange evaluation function.
+     * Static exchange evaluation function. pos is not modified.
      * @return SEE score for m. Positive value is good for the side that makes the first move.
      */
-    static int SEE(Position& pos, const Move& m, int alpha, int beta);
+    static int SEE(const Position& pos, const Move& m, int alpha, int beta);
 
     /** Return the quiescence search score and corresponding position. */
     std::pair<int,Position::SerializeData>
@@ -235,23 +240,54 @@ private:
      * Static exchange evaluation function.
      * @return SEE score for m. Positive value is good for the side that makes the first move.
      */
-    int SEE(const Move& m, int alpha, int beta);
+    int SEE(const Move& m, int alpha, int beta) const;
 
     /** Return >0, 0, <0, depending on the sign of SEE(m). */
-    int signSEE(const Move& m);
+    int signSEE(const Move& m) const;
 
     /** Return true if SEE(m) < 0. */
-    bool negSEE(const Move& m);
+    bool negSEE(const Move& m) const;
 
-    /** Score move list according to most valuable victim / least valuable attacker. */
+    /** Score move list according to most valuable victim. Captures of the same
+     *  victim type are ordered by capture history and least valuable attacker. */
     void scoreMoveListMvvLva(MoveList& moves) const;
 
     /** Find move with highest score and move it to the front of the list. */
     static void selectBest(MoveList& moves, int startIdx);
 
+    /** Get the history contexts for the last two moves leading to the
+     *  current position, or -1 if not available. */
+    void getHistContext(int ply, int& prev1, int& prev2) const;
+
     /** If hashMove exists in the move list, move the hash move to the front of the list. */
     static bool selectHashMove(MoveList& moves, const Move& hashMove);
 
+    /** Move generation stages used by negaScout(). */
+    enum MoveGenStage {
+        STAGE_CAPTURES,   // Captures, queen/knight promotions and en passant
+        STAGE_KILLERS,    // Killer moves that are pseudo-legal in the current position
+        STAGE_QUIETS,     // Remaining non-capture moves
+        STAGE_EVASIONS,   // All check evasions, used when in check
+        STAGE_DONE
+    };
+
+    /** State for generating moves in stages. The hash move is searched before
+     *  any moves are generated, so if it causes a beta cutoff no move
+     *  generation or move scoring is needed. */
+    struct MoveStages {
+        explicit MoveStages(bool inCheck)
+            : stage(inCheck ? STAGE_EVASIONS : STAGE_CAPTURES) {}
+        MoveGenStage stage;
+        Move hashMove;    // Hash move if it is included in the move list
+        Move killers[2];  // Killer moves included in the move list
+        int nKillers = 0;
+    };
+
+    /** Generate and score the moves for the next non-empty stage and append
+     *  them to "moves". Moves already in the list are not added again.
+     *  @return False if all stages are done. */
+    bool nextMoveStage(MoveList& moves, MoveStages& ms, int ply);
+
     class DefaultStopHandler : public StopHandler {
     public:
         explicit DefaultStopHandler(Search& sc0) : sc(sc0) { }
@@ -274,6 +310,7 @@ private:
     ClusterTT& tt;
     Communicator& comm;
     int jobId = 0;
+    bool lazySMP = false; // True if helper threads run independent searches from the root
     int threadNo;
     TreeLogger& logFile;
 
@@ -340,6 +377,30 @@ Search::canClaimDrawRep(const Position& pos, const std::vector<U64>& posHashList
     return false;
 }
 
+inline bool
+Search::hasUpcomingRep(const Position& pos, const std::vector<U64>& posHashList,
+                       int posHashListSize, int posHashFirstNew) {
+    int end = std::min(pos.getHalfMoveClock(), posHashListSize);
+    if (end < 3)
+        return false;
+    const U64 key = pos.zobristHash();
+    const U64 occupied = pos.occupiedBB();
+    int stop = std::max(posHashListSize - end, posHashFirstNew);
+    for (int i = posHashListSize - 3; i >= stop; i -= 2) {
+        Square s1, s2;
+        if (!Position::getCuckooMove(key ^ posHashList[i], s1, s2))
+            continue;
+        if (BitBoard::squaresBetween(s1, s2) & occupied)
+            continue;
+        int p = pos.getPiece(s1);
+        if (p == Piece::EMPTY)
+            p = pos.getPiece(s2);
+        if (Piece::isWhite(p) == pos.isWhiteMove())
+            return true;
+    }
+    return false;
+}
+
 inline bool
 Search::passedPawnPush(const Position& pos, const Move& m) {
     int p = pos.getPiece(m.from());
@@ -373,12 +434,12 @@ Search::isExpectedCutNode(int ply) const {
 }
 
 inline int
-Search::SEE(const Move& m, int alpha, int beta) {
+Search::SEE(const Move& m, int alpha, int beta) const {
     return SEE(pos, m, alpha, beta);
 }
 
 inline int
-Search::signSEE(const Move& m) {
+Search::signSEE(const Move& m) const {
     int p0 = ::pieceValue[pos.getPiece(m.from())];
     int p1 = ::pieceValue[pos.getPiece(m.to())];
     if (p0 < p1)
@@ -387,7 +448,7 @@ Search::signSEE(const Move& m) {
 }
 
 inline bool
-Search::negSEE(const Move& m) {
+Search::negSEE(const Move& m) const {
     int p0 = ::pieceValue[pos.getPiece(m.from())];
     int p1 = ::pieceValue[pos.getPiece(m.to())];
     if (p1 >= p0)
@@ -395,16 +456,6 @@ Search::negSEE(const Move& m) {
     return SEE(m, -1, 0) < 0;
 }
 
-inline void
-Search::scoreMoveListMvvLva(MoveList& moves) const {
-    for (int i = 0; i < moves.size; i++) {
-        Move& m = moves[i];
-        int v = pos.getPiece(m.to());
-        int a = pos.getPiece(m.from());
-        m.setScore(Evaluate::pieceValueOrder[v] * 8 - Evaluate::pieceValueOrder[a]);
-    }
-}
-
 inline void
 Search::selectBest(MoveList& moves, int startIdx) {
     int bestIdx = startIdx;
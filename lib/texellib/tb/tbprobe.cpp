@@ -313,8 +313,7 @@ TBProbe::extendPV(const Position& rootPos, std::vector<Move>& pv, const Transpos
         score = -score;
     while (true) {
         MoveList moveList;
-        MoveGen::pseudoLegalMoves(pos, moveList);
-        MoveGen::removeIllegal(pos, moveList);
+        MoveGen::legalMoves(pos, moveList);
         bool extended = false;
         for (int mi = 0; mi < moveList.size; mi++) {
             const Move& m = moveList[mi];
@@ -72,7 +72,7 @@ public:
      * in KPK if the KQK table is missing and search is not able to see the mate
      * after promoting the pawn.
      * @param pos           The root position.
-     * @param legalMoves    The set of legal root moves.
+     * @param legalMoves    The set of legal root moves, as generated by MoveGen::legalMoves().
      * @param movesToSearch The moves to search.
      * @param tt            TranspositionTable that can contain on-demand tablebase.
      * @return True if a subset should be searched, false to search all moves.
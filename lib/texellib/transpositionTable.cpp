@@ -28,9 +28,22 @@
 #include "moveGen.hpp"
 #include "textio.hpp"
 #include "largePageAlloc.hpp"
+#include "alignedAlloc.hpp"
+#include "numa.hpp"
 
 #include <iostream>
 #include <iomanip>
+#include <thread>
+#include <new>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 TranspositionTable::TranspositionTable(U64 numEntries)
@@ -39,29 +52,34 @@ TranspositionTable::TranspositionTable(U64 numEntries)
 }
 
 void
-TranspositionTable::reSize(U64 numEntries) {
-    if (numEntries < 4)
-        numEntries = 4;
+TranspositionTable::reSize(U64 numEntries, int nThreads) {
+    U64 numBuckets = (numEntries + TTBucket::numEntries - 1) / TTBucket::numEntries;
+    if (numBuckets < 1)
+        numBuckets = 1;
 
-    tableV.clear();
-    tableV.shrink_to_fit();
-    tableLP.reset();
+    tableMem.reset();
     table = nullptr;
     tableSize = 0;
 
-    tableLP = LargePageAlloc::allocate<TTEntryStorage>(numEntries);
-    if (tableLP) {
-        table = tableLP.get();
-    } else {
-        tableV.resize(numEntries);
-        table = &tableV[0];
+    // Memory is not touched here, so that clear() decides where the pages are placed
+    tableMem = LargePageAlloc::allocate<TTBucket>(numBuckets);
+    if (!tableMem) {
+        AlignedAllocator<TTBucket> alloc;
+        tableMem = std::shared_ptr<TTBucket>(alloc.allocate(numBuckets),
+                                             [numBuckets](TTBucket* p) {
+                                                 AlignedAllocator<TTBucket>().deallocate(p, numBuckets);
+                                             });
     }
-    tableSize = numEntries;
+    table = tableMem.get();
+    tableSize = numBuckets;
 
     generation = 0;
-    setUsedSize(tableSize);
-    tbGen.reset();
-    notUsedCnt = 0;
+    clear(nThreads);
+}
+
+U64
+TranspositionTable::numEntriesForSize(U64 numBytes) {
+    return numBytes / sizeof(TTBucket) * TTBucket::numEntries;
 }
 
 void TranspositionTable::setUsedSize(U64 s) {
@@ -73,17 +91,45 @@ void TranspositionTable::setUsedSize(U64 s) {
         usedSizeShift++;
     }
     usedSizeTopBits = (int)topBits;
-    usedSizeMask = ((1ULL << usedSizeShift) - 1) & ~3ULL;
+    usedSizeMask = (1ULL << usedSizeShift) - 1;
 }
 
 void
-TranspositionTable::clear() {
+TranspositionTable::clear(int nThreads) {
     setUsedSize(tableSize);
     tbGen.reset();
     notUsedCnt = 0;
-    TTEntry ent;
-    for (size_t i = 0; i < tableSize; i++)
-        ent.store(table[i]);
+
+    forEachSlice(nThreads, [this](U64 begin, U64 end) {
+        clearRange(begin, end);
+    });
+}
+
+void
+TranspositionTable::forEachSlice(int nThreads, const std::function<void(U64,U64)>& func) {
+    const U64 minBuckets = 1024 * 1024 / sizeof(TTBucket);
+    nThreads = (int)std::max((U64)1, std::min((U64)nThreads, tableSize / minBuckets));
+    if (nThreads == 1) {
+        func(0, tableSize);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        U64 begin = tableSize * i / nThreads;
+        U64 end = tableSize * (i + 1) / nThreads;
+        threads.emplace_back([i,begin,end,&func]() {
+            Numa::instance().bindThread(i);
+            func(begin, end);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+}
+
+void
+TranspositionTable::clearRange(U64 begin, U64 end) {
+    for (U64 b = begin; b < end; b++)
+        new (&table[b]) TTBucket();
 }
 
 void
@@ -98,30 +144,30 @@ TranspositionTable::setWhiteContempt(int contempt) {
 
 void
 TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore,
-                           bool busy) {
+                           bool busy, Stats* stats) {
     key ^= contemptHash;
     if (depth < 0) depth = 0;
-    size_t idx0 = getIndex(key);
+    TTBucket& b = table[getIndex(key)];
+    const U64 pKey = partialKey(key);
     TTEntry ent, tmp;
-    size_t idx = idx0;
-    for (int i = 0; i < 4; i++) {
-        size_t idx1 = idx0 + i;
-        tmp.load(table[idx1]);
-        if (tmp.getKey() == key) {
+    int idx = 0;
+    for (int i = 0; i < TTBucket::numEntries; i++) {
+        tmp.load(b, i);
+        if (tmp.getKey() == pKey) {
             ent = tmp;
-            idx = idx1;
+            idx = i;
             break;
         } else if (i == 0) {
             ent = tmp;
-            idx = idx1;
+            idx = i;
         } else if (ent.betterThan(tmp, generation)) {
             ent = tmp;
-            idx = idx1;
+            idx = i;
         }
     }
     bool doStore = true;
     if (!busy) {
-        if ((ent.getKey() == key) && (ent.getDepth() > depth) && (ent.getType() == type)) {
+        if ((ent.getKey() == pKey) && (ent.getDepth() > depth) && (ent.getType() == type)) {
             if (type == TType::T_EXACT)
                 doStore = false;
             else if ((type == TType::T_GE) && (sm.score() <= ent.getScore(ply)))
@@ -130,8 +176,25 @@ TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth
                 doStore = false;
         }
     }
+    if (stats) {
+        if (!doStore) {
+            Stats::inc(stats->notStored);
+        } else {
+            Stats::inc(stats->stores);
+            Stats::ReplaceReason r;
+            if (ent.getKey() == pKey && ent.getType() != TType::T_EMPTY)
+                r = Stats::SAME_KEY;
+            else if (ent.getType() == TType::T_EMPTY)
+                r = Stats::EMPTY;
+            else if (ent.getGeneration() != generation)
+                r = Stats::OLD_GENERATION;
+            else
+                r = Stats::LESS_VALUABLE;
+            Stats::inc(stats->replaced[r]);
+        }
+    }
     if (doStore) {
-        if ((ent.getKey() != key) || (sm.from() != sm.to()))
+        if ((ent.getKey() != pKey) || (sm.from() != sm.to()))
             ent.setMove(sm);
         ent.setKey(key);
         ent.setScore(sm.score(), ply);
@@ -140,7 +203,7 @@ TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth
         ent.setGeneration((S8)generation);
         ent.setType(type);
         ent.setEvalScore(evalScore);
-        ent.store(table[idx]);
+        ent.store(b, idx);
     }
 }
 
@@ -236,24 +299,27 @@ TranspositionTable::printStats(int rootDepth) const {
     int unused = 0;
     int thisGen = 0;
     std::vector<int> depHist;
-    for (size_t i = 0; i < tableSize; i++) {
-        TTEntry ent;
-        ent.load(table[i]);
-        if (ent.getType() == TType::T_EMPTY) {
-            unused++;
-        } else {
-            if (ent.getGeneration() == generation)
-                thisGen++;
-            int d = ent.getDepth();
-            while ((int)depHist.size() <= d)
-                depHist.push_back(0);
-            depHist[d]++;
+    for (size_t b = 0; b < tableSize; b++) {
+        for (int i = 0; i < TTBucket::numEntries; i++) {
+            TTEntry ent;
+            ent.load(table[b], i);
+            if (ent.getType() == TType::T_EMPTY) {
+                unused++;
+            } else {
+                if (ent.getGeneration() == generation)
+                    thisGen++;
+                int d = ent.getDepth();
+                while ((int)depHist.size() <= d)
+                    depHist.push_back(0);
+                depHist[d]++;
+            }
         }
     }
-    double w = 100.0 / tableSize;
+    const U64 numEntries = tableSize * TTBucket::numEntries;
+    double w = 100.0 / numEntries;
     std::stringstream ss;
     ss.precision(2);
-    ss << std::fixed << "hstat: d:" << rootDepth << " size:" << tableSize
+    ss << std::fixed << "hstat: d:" << rootDepth << " size:" << numEntries
        << " unused:" << unused << " (" << (unused*w) << "%)"
        << " thisGen:" << thisGen << " (" << (thisGen*w) << "%)" << std::endl;
     std::cout << ss.str();
@@ -272,19 +338,189 @@ TranspositionTable::printStats(int rootDepth) const {
 
 int
 TranspositionTable::getHashFull() const {
-    if (tableSize < 1000)
+    const int nBuckets = 1000 / TTBucket::numEntries + 1;
+    if (tableSize < (U64)nBuckets)
         return 0;
     int hashFull = 0;
-    for (int i = 0; i < 1000; i++) {
-        TTEntry ent;
-        ent.load(table[i]);
-        if ((ent.getType() != TType::T_EMPTY) &&
-            (ent.getGeneration() == generation))
-            hashFull++;
+    int n = 0;
+    for (int b = 0; b < nBuckets; b++) {
+        for (int i = 0; i < TTBucket::numEntries && n < 1000; i++, n++) {
+            TTEntry ent;
+            ent.load(table[b], i);
+            if ((ent.getType() != TType::T_EMPTY) &&
+                (ent.getGeneration() == generation))
+                hashFull++;
+        }
     }
     return hashFull;
 }
 
+void
+TranspositionTable::Stats::reset() {
+    probes = 0;
+    hits = 0;
+    collisions = 0;
+    busyHits = 0;
+    stores = 0;
+    notStored = 0;
+    for (int i = 0; i < NUM_REASONS; i++)
+        replaced[i] = 0;
+}
+
+void
+TranspositionTable::Stats::add(const Stats& other) {
+    probes = probes + other.probes;
+    hits = hits + other.hits;
+    collisions = collisions + other.collisions;
+    busyHits = busyHits + other.busyHits;
+    stores = stores + other.stores;
+    notStored = notStored + other.notStored;
+    for (int i = 0; i < NUM_REASONS; i++)
+        replaced[i] = replaced[i] + other.replaced[i];
+}
+
+std::string
+TranspositionTable::Stats::toString() const {
+    auto percent = [](S64 n, S64 tot) -> double {
+        return tot > 0 ? n * 100.0 / tot : 0.0;
+    };
+    std::stringstream ss;
+    ss.precision(1);
+    ss << std::fixed
+       << "hash probes " << probes
+       << " hits " << hits << " (" << percent(hits, probes) << "%)"
+       << " collisions " << collisions
+       << " busy " << busyHits
+       << " stores " << stores
+       << " samekey " << percent(replaced[SAME_KEY], stores) << "%"
+       << " empty " << percent(replaced[EMPTY], stores) << "%"
+       << " oldgen " << percent(replaced[OLD_GENERATION], stores) << "%"
+       << " lessvaluable " << percent(replaced[LESS_VALUABLE], stores) << "%"
+       << " notstored " << notStored;
+    return ss.str();
+}
+
+std::shared_ptr<TranspositionTable::Stats>
+TranspositionTable::newThreadStats() {
+    auto stats = std::allocate_shared<Stats>(AlignedAllocator<Stats>());
+    std::lock_guard<std::mutex> L(statsMutex);
+    threadStats.erase(std::remove_if(threadStats.begin(), threadStats.end(),
+                                     [](const std::weak_ptr<Stats>& w) { return w.expired(); }),
+                      threadStats.end());
+    threadStats.push_back(stats);
+    return stats;
+}
+
+void
+TranspositionTable::getStats(Stats& total) {
+    total.reset();
+    std::lock_guard<std::mutex> L(statsMutex);
+    for (auto& w : threadStats)
+        if (auto stats = w.lock())
+            total.add(*stats);
+}
+
+void
+TranspositionTable::resetStats() {
+    std::lock_guard<std::mutex> L(statsMutex);
+    for (auto& w : threadStats)
+        if (auto stats = w.lock())
+            stats->reset();
+}
+
+// --------------------------------------------------------------------------------
+
+TranspositionTable::SnapshotHeader
+TranspositionTable::getSnapshotHeader() const {
+    SnapshotHeader h;
+    h.magic = snapshotMagic;
+    h.version = snapshotVersion;
+    h.bucketSize = sizeof(TTBucket);
+    h.entriesPerBucket = TTBucket::numEntries;
+    h.partialKeyBits = partialKeyBits;
+    h.hashScheme = TextIO::readFEN(TextIO::startPosFEN).historyHash();
+    h.tableSize = tableSize;
+    h.contemptHash = contemptHash;
+    h.generation = generation;
+    return h;
+}
+
+bool
+TranspositionTable::saveSnapshot(const std::string& filename) const {
+    std::ofstream os(filename, std::ios::binary);
+    if (!os)
+        return false;
+    SnapshotHeader h = getSnapshotHeader();
+    os.write((const char*)&h, sizeof(h));
+    os.write((const char*)table, byteSize());
+    os.close();
+    return !!os;
+}
+
+bool
+TranspositionTable::loadSnapshot(const std::string& filename, int nThreads) {
+    const SnapshotHeader expected = getSnapshotHeader();
+    const U64 fileSize = sizeof(SnapshotHeader) + byteSize();
+    auto headerOk = [&expected](const SnapshotHeader& h) -> bool {
+        return h.magic == expected.magic &&
+               h.version == expected.version &&
+               h.bucketSize == expected.bucketSize &&
+               h.entriesPerBucket == expected.entriesPerBucket &&
+               h.partialKeyBits == expected.partialKeyBits &&
+               h.hashScheme == expected.hashScheme &&
+               h.tableSize == expected.tableSize;
+    };
+    SnapshotHeader h;
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) != 0 || (U64)statBuf.st_size != fileSize) {
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        return false;
+    std::shared_ptr<void> memHolder(mem, [fileSize](void* p) { munmap(p, fileSize); });
+    madvise(mem, fileSize, MADV_SEQUENTIAL);
+    memcpy(&h, mem, sizeof(h));
+    if (!headerOk(h))
+        return false;
+    const U8* data = (const U8*)mem + sizeof(SnapshotHeader);
+#else
+    std::ifstream is(filename, std::ios::binary);
+    if (!is)
+        return false;
+    is.seekg(0, std::ios::end);
+    if ((U64)is.tellg() != fileSize)
+        return false;
+    is.seekg(0, std::ios::beg);
+    is.read((char*)&h, sizeof(h));
+    if (!is || !headerOk(h))
+        return false;
+    std::vector<U8> buf(byteSize());
+    is.read((char*)buf.data(), buf.size());
+    if (!is)
+        return false;
+    const U8* data = buf.data();
+#endif
+
+    setUsedSize(tableSize);
+    tbGen.reset();
+    notUsedCnt = 0;
+    forEachSlice(nThreads, [this,data](U64 begin, U64 end) {
+        memcpy((void*)&table[begin], data + begin * sizeof(TTBucket),
+               (end - begin) * sizeof(TTBucket));
+    });
+    generation = h.generation;
+    contemptHash = h.contemptHash;
+    return true;
+}
+
 // --------------------------------------------------------------------------------
 
 bool
@@ -309,7 +545,7 @@ TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMil
     if (maxTimeMillis >= 0 && maxTimeMillis < requiredTime)
         return false; // Not enough time to generate TB
 
-    U64 ttSize = tableSize * sizeof(TTEntryStorage);
+    U64 ttSize = byteSize();
     const int tbSize = 5 * 1024 * 1024; // Max TB size, 10*64^3*2
     if (ttSize < tbSize + 2 * 1024 * 1024)
         return false;
@@ -332,7 +568,7 @@ TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMil
             requiredTime = std::max(maxT, requiredTime) * 2;
         return false;
     }
-    setUsedSize(tableSize - tbSize / sizeof(TTEntryStorage));
+    setUsedSize(tableSize - tbSize / sizeof(TTBucket));
     notUsedCnt = 0;
     return true;
 }
@@ -34,6 +34,8 @@
 
 #include <memory>
 #include <vector>
+#include <functional>
+#include <mutex>
 
 #if _MSC_VER
 #include <xmmintrin.h>
@@ -60,20 +62,38 @@ private:
 
 
 /**
- * Implements the main transposition table using Cuckoo hashing.
+ * Implements the main transposition table. Each position maps to a bucket
+ * of entries occupying one cache line.
  */
 class TranspositionTable {
 private:
-    /** In-memory representation of TT entry. Uses std::atomic for thread safety,
-     * but accessed using memory_order_relaxed for maximum performance. */
-    struct TTEntryStorage {
-        std::atomic<U64> key;
-        std::atomic<U64> data;
-        TTEntryStorage();
-        TTEntryStorage(const TTEntryStorage& a);
-        TTEntryStorage& operator=(const TTEntryStorage& a) = delete;
+    /** In-memory representation of a bucket of TT entries, occupying one cache line.
+     * The data part of each entry is stored in its own 64-bit word. The key part is
+     * reduced to a partial key, which is combined with a hash of the data part and
+     * packed three at a time in the two remaining 64-bit words. Uses std::atomic for
+     * thread safety, but accessed using memory_order_relaxed for maximum performance. */
+    struct alignas(64) TTBucket {
+        static constexpr int numEntries = 6;
+        static constexpr int keysPerWord = 3;
+        std::atomic<U64> data[numEntries];
+        std::atomic<U64> keys[numEntries / keysPerWord];
+        TTBucket();
+        TTBucket(const TTBucket& a) = delete;
+        TTBucket& operator=(const TTBucket& a) = delete;
+
+        /** Access the bucket as an array of 8 64-bit words. */
+        std::atomic<U64>& word(int w);
     };
-    static_assert(sizeof(TTEntryStorage) == 16, "TTEntryStorage size wrong");
+    static_assert(sizeof(TTBucket) == 64, "TTBucket size wrong");
+
+    /** Number of key bits stored in a bucket entry. */
+    static constexpr int partialKeyBits = 21;
+    static constexpr U64 partialKeyMask = (1ULL << partialKeyBits) - 1;
+
+    /** Get the part of a key that is stored in a bucket entry. Bits used
+     *  by getIndex() are not included, since they are implied by the
+     *  position of the bucket in the table. */
+    static U64 partialKey(U64 key);
 
 public:
     /** A local copy of a transposition table entry. */
@@ -85,11 +105,12 @@ public:
         /** Set type to T_EMPTY. */
         void clear();
 
-        /** Store in transposition table, encoded for thread safety. */
-        void store(TTEntryStorage& ent);
+        /** Store in entry "i" of a bucket, encoded for thread safety. */
+        void store(TTBucket& b, int i);
 
-        /** Load from transposition table, decode the thread safety encoding. */
-        void load(const TTEntryStorage& ent);
+        /** Load from entry "i" of a bucket, decode the thread safety encoding.
+         *  Only the partial key is available after loading. */
+        void load(const TTBucket& b, int i);
 
         /** Return true if this object is more valuable than the other, false otherwise. */
         bool betterThan(const TTEntry& other, int currGen) const;
@@ -124,6 +145,9 @@ public:
         void setEvalScore(int s);
 
     private:
+        /** Hash of the data part, used to detect partially written entries. */
+        static U64 dataHash(U64 data);
+
         U64 key;        //  0 64 key         Zobrist hash key
         U64 data;       //  0 16 move        from + (to<<6) + (promote<<12)
                         // 16 16 score       Score from search
@@ -137,24 +161,63 @@ public:
         unsigned int getBits(int first, int size) const;
     };
 
-    /** Constructor. Creates an empty transposition table with numEntries slots. */
+    /** Transposition table usage statistics. Each search thread has its own
+     *  instance, so counters can be updated without contention. Cache line
+     *  aligned so that instances used by different threads never share a line. */
+    struct alignas(64) Stats {
+        /** Reason an entry was chosen for replacement in insert(). */
+        enum ReplaceReason {
+            SAME_KEY,       // Entry for the same position updated
+            EMPTY,          // Empty entry used
+            OLD_GENERATION, // Entry from an older search replaced
+            LESS_VALUABLE,  // Least valuable entry according to betterThan()
+            NUM_REASONS
+        };
+
+        Stats() { reset(); }
+        void reset();
+
+        /** Add counter values from "other" to this object. */
+        void add(const Stats& other);
+
+        /** Increment a counter. Only called by the owning thread. */
+        static void inc(RelaxedShared<S64>& cnt) { cnt = cnt + 1; }
+
+        /** Return statistics formatted on one line. */
+        std::string toString() const;
+
+        RelaxedShared<S64> probes;
+        RelaxedShared<S64> hits;
+        RelaxedShared<S64> collisions; // Hits where the hash move was not valid
+        RelaxedShared<S64> busyHits;   // ABDADA busy cutoffs
+        RelaxedShared<S64> stores;
+        RelaxedShared<S64> notStored;  // Inserts ignored because existing entry was better
+        RelaxedShared<S64> replaced[NUM_REASONS];
+    };
+
+    /** Constructor. Creates an empty transposition table with at least numEntries slots. */
     explicit TranspositionTable(U64 numEntries);
     TranspositionTable(const TranspositionTable& other) = delete;
     TranspositionTable operator=(const TranspositionTable& other) = delete;
 
-    void reSize(U64 numEntries);
+    /** Change the table size. The new table is initialized by clear(nThreads). */
+    void reSize(U64 numEntries, int nThreads = 1);
+
+    /** Return the number of entries that fit in the given number of bytes. */
+    static U64 numEntriesForSize(U64 numBytes);
 
     void setWhiteContempt(int contempt);
 
-    /** Insert an entry in the hash table. */
+    /** Insert an entry in the hash table. If stats is not null, update statistics. */
     void insert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore,
-                bool busy = false);
+                bool busy = false, Stats* stats = nullptr);
 
     /** Set the busy flag for an entry. Used by "approximate ABDADA" algorithm. */
     void setBusy(const TTEntry& ent, int ply);
 
-    /** Retrieve an entry from the hash table corresponding to position with zobrist key "key". */
-    void probe(U64 key, TTEntry& result);
+    /** Retrieve an entry from the hash table corresponding to position with zobrist key "key".
+     *  If stats is not null, update statistics. */
+    void probe(U64 key, TTEntry& result, Stats* stats = nullptr);
 
     /** Prefetch cache line. */
     void prefetch(U64 key);
@@ -165,8 +228,11 @@ public:
      */
     void nextGeneration();
 
-    /** Clear the transposition table. */
-    void clear();
+    /** Clear the transposition table. The work is split between nThreads threads.
+     *  Thread i is bound to the same NUMA node as search thread i, so that the
+     *  memory pages are distributed between NUMA nodes the same way as the
+     *  search threads. */
+    void clear(int nThreads = 1);
 
     /** Extract a list of PV moves, starting from "rootPos" and first move "mFirst". */
     void extractPVMoves(const Position& rootPos, const Move& mFirst, std::vector<Move>& pv);
@@ -181,6 +247,29 @@ public:
      *  Only an approximate value is returned. */
     int getHashFull() const;
 
+    /** Create a statistics object for a search thread. The object is
+     *  included in getStats() as long as it is referenced by the caller. */
+    std::shared_ptr<Stats> newThreadStats();
+
+    /** Get the sum of all thread statistics. */
+    void getStats(Stats& total);
+
+    /** Reset all thread statistics. */
+    void resetStats();
+
+
+    // Methods to save and restore the table contents
+
+    /** Write the table contents and state to a file. Return true if successful. */
+    bool saveSnapshot(const std::string& filename) const;
+
+    /** Restore table contents and state from a file created by saveSnapshot().
+     *  The file must have been created by a table of the same size and
+     *  hashing scheme. The file is memory mapped and copied to the table
+     *  using nThreads threads, see clear(). Return true if successful,
+     *  otherwise the table is not modified. */
+    bool loadSnapshot(const std::string& filename, int nThreads = 1);
+
 
     // Methods to handle tablebase generation and probing
 
@@ -208,23 +297,50 @@ private:
     /** Set how much of the hash table to use. */
     void setUsedSize(U64 s);
 
-    /** Get position in hash table given zobrist key. */
+    /** Get bucket position in hash table given zobrist key. */
     size_t getIndex(U64 key) const;
 
+    /** Initialize buckets in the range [begin,end) to empty entries. */
+    void clearRange(U64 begin, U64 end);
+
+    /** Split the table in up to nThreads slices and call func(begin, end) for
+     *  each slice in a thread bound to the corresponding NUMA node. */
+    void forEachSlice(int nThreads, const std::function<void(U64,U64)>& func);
+
+    /** Header of a table snapshot file. */
+    struct SnapshotHeader {
+        U64 magic;
+        U32 version;
+        U32 bucketSize;
+        U32 entriesPerBucket;
+        U32 partialKeyBits;
+        U64 hashScheme;     // Hash key of the start position
+        U64 tableSize;      // Number of buckets
+        U64 contemptHash;
+        U64 generation;
+    };
+    static const U64 snapshotMagic = 0x5454584554ULL; // "TEXTT"
+    static const U32 snapshotVersion = 1;
+
+    /** Get the snapshot header corresponding to the current table state. */
+    SnapshotHeader getSnapshotHeader() const;
+
 
-    TTEntryStorage* table; // Points to either tableV or tableLP
+    TTBucket* table; // Points to tableMem
 
-    U64 usedSize = 0;        // Number of used entries. Smaller than tableSize when TB used
+    U64 usedSize = 0;        // Number of used buckets. Smaller than tableSize when TB used
     int usedSizeTopBits = 0; // < 256, (usedSizeTopBits << usedSizeShift) <= usedSize
     int usedSizeShift = 0;
     U64 usedSizeMask = 0;
 
     U8 generation = 0;
     U64 contemptHash = 0;
-    U64 tableSize = 0;     // Number of entries
+    U64 tableSize = 0;     // Number of buckets
 
-    vector_aligned<TTEntryStorage> tableV;
-    std::shared_ptr<TTEntryStorage> tableLP; // Large page allocation if used
+    std::shared_ptr<TTBucket> tableMem; // Uninitialized memory, large pages if available
+
+    std::mutex statsMutex;
+    std::vector<std::weak_ptr<Stats>> threadStats;
 
     // On-demand TB generation
     TTStorage ttStorage;
@@ -256,15 +372,19 @@ TTStorage::store(U32 idx, PositionValue pv) {
 
 
 inline
-TranspositionTable::TTEntryStorage::TTEntryStorage() {
-    key.store(0, std::memory_order_relaxed);
-    data.store(0, std::memory_order_relaxed);
+TranspositionTable::TTBucket::TTBucket() {
+    for (int w = 0; w < 8; w++)
+        word(w).store(0, std::memory_order_relaxed);
 }
 
-inline
-TranspositionTable::TTEntryStorage::TTEntryStorage(const TTEntryStorage& a) {
-    key.store(a.key.load(std::memory_order_relaxed), std::memory_order_relaxed);
-    data.store(a.data.load(std::memory_order_relaxed), std::memory_order_relaxed);
+inline std::atomic<U64>&
+TranspositionTable::TTBucket::word(int w) {
+    return w < numEntries ? data[w] : keys[w - numEntries];
+}
+
+inline U64
+TranspositionTable::partialKey(U64 key) {
+    return (key >> 27) & partialKeyMask;
 }
 
 
@@ -275,17 +395,33 @@ TranspositionTable::TTEntry::clear() {
     static_assert(TType::T_EMPTY == 0, "type not set to T_EMPTY");
 }
 
+inline U64
+TranspositionTable::TTEntry::dataHash(U64 data) {
+    return (data * 0x9E3779B97F4A7C15ULL) >> (64 - partialKeyBits);
+}
+
 inline void
-TranspositionTable::TTEntry::store(TTEntryStorage& ent) {
-    ent.key.store(key ^ data, std::memory_order_relaxed);
-    ent.data.store(data, std::memory_order_relaxed);
+TranspositionTable::TTEntry::store(TTBucket& b, int i) {
+    const int w = i / TTBucket::keysPerWord;
+    const int shift = (i % TTBucket::keysPerWord) * partialKeyBits;
+    U64 check = (partialKey(key) ^ dataHash(data)) & partialKeyMask;
+    b.data[i].store(data, std::memory_order_relaxed);
+    // The key word is shared with sibling entries, so use CAS to not
+    // overwrite check values stored concurrently by other threads.
+    U64 keyWord = b.keys[w].load(std::memory_order_relaxed);
+    while (!b.keys[w].compare_exchange_weak(keyWord,
+                                            (keyWord & ~(partialKeyMask << shift)) | (check << shift),
+                                            std::memory_order_relaxed))
+        ;
 }
 
 inline void
-TranspositionTable::TTEntry::load(const TTEntryStorage& ent) {
-    key = ent.key.load(std::memory_order_relaxed);
-    data = ent.data.load(std::memory_order_relaxed);
-    key ^= data;
+TranspositionTable::TTEntry::load(const TTBucket& b, int i) {
+    const int w = i / TTBucket::keysPerWord;
+    const int shift = (i % TTBucket::keysPerWord) * partialKeyBits;
+    data = b.data[i].load(std::memory_order_relaxed);
+    U64 check = (b.keys[w].load(std::memory_order_relaxed) >> shift) & partialKeyMask;
+    key = check ^ dataHash(data);
 }
 
 inline bool
@@ -442,18 +578,24 @@ TranspositionTable::getIndex(U64 key) const {
 }
 
 inline void
-TranspositionTable::probe(U64 key, TTEntry& result) {
+TranspositionTable::probe(U64 key, TTEntry& result, Stats* stats) {
     key ^= contemptHash;
-    size_t idx0 = getIndex(key);
+    TTBucket& b = table[getIndex(key)];
+    const U64 pKey = partialKey(key);
+    if (stats)
+        Stats::inc(stats->probes);
     TTEntry ent;
-    for (int i = 0; i < 4; i++) {
-        ent.load(table[idx0 + i]);
-        if (ent.getKey() == key) {
+    for (int i = 0; i < TTBucket::numEntries; i++) {
+        ent.load(b, i);
+        if (ent.getKey() == pKey && ent.getType() != TType::T_EMPTY) {
+            ent.setKey(key);
             if (ent.getGeneration() != generation) {
                 ent.setGeneration(generation);
-                ent.store(table[idx0 + i]);
+                ent.store(b, i);
             }
             result = ent;
+            if (stats)
+                Stats::inc(stats->hits);
             return;
         }
     }
@@ -464,11 +606,11 @@ inline void
 TranspositionTable::prefetch(U64 key) {
 #ifdef HAS_PREFETCH
     key ^= contemptHash;
-    size_t idx0 = getIndex(key);
+    size_t idx = getIndex(key);
 #if _MSC_VER
-    _mm_prefetch((const char*)&table[idx0], 3);
+    _mm_prefetch((const char*)&table[idx], 3);
 #else
-    __builtin_prefetch(&table[idx0]);
+    __builtin_prefetch(&table[idx]);
 #endif
 #endif
 }
@@ -480,35 +622,28 @@ TranspositionTable::nextGeneration() {
 
 inline U8
 TranspositionTable::getByte(U64 idx) {
-    U64 ent = idx / 16;
-    int offs = idx & 0xf;
-    U64 data = (offs < 8) ? table[ent].key.load(std::memory_order_relaxed)
-                          : table[ent].data.load(std::memory_order_relaxed);
-    offs &= 0x7;
+    U64 b = idx / sizeof(TTBucket);
+    int w = (idx / 8) & 7;
+    int offs = idx & 0x7;
+    U64 data = table[b].word(w).load(std::memory_order_relaxed);
     return (data >> (offs * 8)) & 0xff;
 }
 
 inline void
 TranspositionTable::putByte(U64 idx, U8 value) {
-    U64 ent = idx / 16;
-    int offs = idx & 0xf;
-    if (offs < 8) {
-        U64 data = table[ent].key.load(std::memory_order_relaxed);
-        data &= ~(0xffULL << (offs * 8));
-        data |= ((U64)value) << (offs * 8);
-        table[ent].key.store(data, std::memory_order_relaxed);
-    } else {
-        offs &= 0x07;
-        U64 data = table[ent].data.load(std::memory_order_relaxed);
-        data &= ~(0xffULL << (offs * 8));
-        data |= ((U64)value) << (offs * 8);
-        table[ent].data.store(data, std::memory_order_relaxed);
-    }
+    U64 b = idx / sizeof(TTBucket);
+    int w = (idx / 8) & 7;
+    int offs = idx & 0x7;
+    std::atomic<U64>& word = table[b].word(w);
+    U64 data = word.load(std::memory_order_relaxed);
+    data &= ~(0xffULL << (offs * 8));
+    data |= ((U64)value) << (offs * 8);
+    word.store(data, std::memory_order_relaxed);
 }
 
 inline U64
 TranspositionTable::byteSize() const {
-    return tableSize * sizeof(TTEntryStorage);
+    return tableSize * sizeof(TTBucket);
 }
 
 
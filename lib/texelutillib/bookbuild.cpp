@@ -850,8 +850,7 @@ std::vector<Move>
 Book::getMovesToSearch(Position& pos) {
     std::vector<Move> ret;
     MoveList moves;
-    MoveGen::pseudoLegalMoves(pos, moves);
-    MoveGen::removeIllegal(pos, moves);
+    MoveGen::legalMoves(pos, moves);
     UndoInfo ui;
     for (int i = 0; i < moves.size; i++) {
         const Move& m = moves[i];
@@ -919,8 +918,7 @@ Book::addPosToBook(Position& pos, const Move& move, std::vector<U64>& toSearch)
         assert(ok);
 
         MoveList moves;
-        MoveGen::pseudoLegalMoves(pos2, moves);
-        MoveGen::removeIllegal(pos2, moves);
+        MoveGen::legalMoves(pos2, moves);
         Move move2;
         bool found = false;
         for (int i = 0; i < moves.size; i++) {
@@ -1050,8 +1048,7 @@ Book::setChildRefs(Position& pos) {
     assert(node);
 
     MoveList moves;
-    MoveGen::pseudoLegalMoves(pos, moves);
-    MoveGen::removeIllegal(pos, moves);
+    MoveGen::legalMoves(pos, moves);
     UndoInfo ui;
     for (int i = 0; i < moves.size; i++) {
         pos.makeMove(moves[i], ui);
@@ -1431,8 +1428,7 @@ SearchRunner::analyze(const std::vector<Move>& gameMoves,
 
     if (movesToSearch.empty()) {
         MoveList legalMoves;
-        MoveGen::pseudoLegalMoves(pos, legalMoves);
-        MoveGen::removeIllegal(pos, legalMoves);
+        MoveGen::legalMoves(pos, legalMoves);
         Move bestMove;
         int bestScore = IGNORE_SCORE;
         if (legalMoves.size == 0) {
@@ -1560,8 +1556,7 @@ SearchScheduler::reportResult(const WorkUnit& wu) const {
     }
     std::set<std::string> excluded;
     MoveList legalMoves;
-    MoveGen::pseudoLegalMoves(pos, legalMoves);
-    MoveGen::removeIllegal(pos, legalMoves);
+    MoveGen::legalMoves(pos, legalMoves);
     for (int i = 0; i < legalMoves.size; i++) {
         const Move& m = legalMoves[i];
         if (!contains(wu.movesToSearch, m))
@@ -416,8 +416,7 @@ ProofGame::search(const Options& opts, Result& result) {
 
         bool anyChildren = false;
         MoveList moves;
-        MoveGen::pseudoLegalMoves(pos, moves);
-        MoveGen::removeIllegal(pos, moves);
+        MoveGen::legalMoves(pos, moves);
         for (int i = 0; i < moves.size; i++) {
             if (((1ULL << moves[i].from()) | (1ULL << moves[i].to())) & blocked)
                 continue;
@@ -512,8 +511,7 @@ ProofGame::getMoves(std::ostream& logStream, const Position& startPos, int idx,
         Position pos;
         pos.deSerialize(nodes[tn.parent].psd);
         MoveList moves;
-        MoveGen::pseudoLegalMoves(pos, moves);
-        MoveGen::removeIllegal(pos, moves);
+        MoveGen::legalMoves(pos, moves);
         UndoInfo ui;
         for (int i = 0; i < moves.size; i++) {
             pos.makeMove(moves[i], ui);
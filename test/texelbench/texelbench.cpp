@@ -0,0 +1,373 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * texelbench.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#include "computerPlayer.hpp"
+#include "search.hpp"
+#include "transpositionTable.hpp"
+#include "evaluate.hpp"
+#include "moveGen.hpp"
+#include "textio.hpp"
+#include "random.hpp"
+#include "timeUtil.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Positions used to exercise the primitives. */
+static const char* fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+};
+
+/** Prevents the compiler from optimizing away benchmarked computations. */
+static volatile S64 sink;
+
+/** A benchmark runs a batch of operations and returns the number of operations done. */
+using BenchFunc = std::function<S64()>;
+
+struct BenchCase {
+    std::string name;
+    std::function<BenchFunc()> setup;
+};
+
+static std::vector<Position>
+getPositions() {
+    std::vector<Position> ret;
+    for (const char* fen : fens)
+        ret.push_back(TextIO::readFEN(fen));
+    return ret;
+}
+
+static std::vector<MoveList>
+getLegalMoves(std::vector<Position>& positions) {
+    std::vector<MoveList> ret(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        MoveGen::pseudoLegalMoves(positions[i], ret[i]);
+        MoveGen::removeIllegal(positions[i], ret[i]);
+    }
+    return ret;
+}
+
+static BenchFunc
+moveGenBench() {
+    auto positions = std::make_shared<std::vector<Position>>(getPositions());
+    return [positions]() {
+        S64 n = 0;
+        S64 sum = 0;
+        for (int rep = 0; rep < 100; rep++) {
+            for (const Position& pos : *positions) {
+                MoveList moves;
+                if (pos.isWhiteMove())
+                    MoveGen::pseudoLegalMoves<true>(pos, moves);
+                else
+                    MoveGen::pseudoLegalMoves<false>(pos, moves);
+                sum += moves.size;
+                n++;
+            }
+        }
+        sink = sum;
+        return n;
+    };
+}
+
+static BenchFunc
+legalMoveGenBench(bool useRemoveIllegal) {
+    auto positions = std::make_shared<std::vector<Position>>(getPositions());
+    return [positions,useRemoveIllegal]() {
+        S64 n = 0;
+        S64 sum = 0;
+        for (int rep = 0; rep < 100; rep++) {
+            for (Position& pos : *positions) {
+                MoveList moves;
+                if (useRemoveIllegal) {
+                    MoveGen::pseudoLegalMoves(pos, moves);
+                    MoveGen::removeIllegal(pos, moves);
+                } else {
+                    MoveGen::legalMoves(pos, moves);
+                }
+                sum += moves.size;
+                n++;
+            }
+        }
+        sink = sum;
+        return n;
+    };
+}
+
+static BenchFunc
+makeMoveBench() {
+    struct State {
+        std::vector<Position> positions = getPositions();
+        std::vector<MoveList> moves = getLegalMoves(positions);
+        std::unique_ptr<Evaluate::EvalHashTables> et = Evaluate::getEvalHashTables();
+    };
+    auto s = std::make_shared<State>();
+    return [s]() {
+        S64 n = 0;
+        S64 sum = 0;
+        Evaluate eval(*s->et);
+        for (int rep = 0; rep < 20; rep++) {
+            for (size_t i = 0; i < s->positions.size(); i++) {
+                Position& pos = s->positions[i];
+                eval.connectPosition(pos);
+                const MoveList& moves = s->moves[i];
+                UndoInfo ui;
+                for (int mi = 0; mi < moves.size; mi++) {
+                    pos.makeMove(moves[mi], ui);
+                    sum += pos.zobristHash();
+                    pos.unMakeMove(moves[mi], ui);
+                    n++;
+                }
+            }
+        }
+        sink = sum;
+        return n;
+    };
+}
+
+static BenchFunc
+seeBench() {
+    struct State {
+        std::vector<Position> positions = getPositions();
+        std::vector<MoveList> moves = getLegalMoves(positions);
+    };
+    auto s = std::make_shared<State>();
+    return [s]() {
+        S64 n = 0;
+        S64 sum = 0;
+        for (int rep = 0; rep < 20; rep++) {
+            for (size_t i = 0; i < s->positions.size(); i++) {
+                Position& pos = s->positions[i];
+                const MoveList& moves = s->moves[i];
+                for (int mi = 0; mi < moves.size; mi++) {
+                    sum += Search::SEE(pos, moves[mi], -SearchConst::MATE0, SearchConst::MATE0);
+                    n++;
+                }
+            }
+        }
+        sink = sum;
+        return n;
+    };
+}
+
+static BenchFunc
+ttBench(int sizeMB, bool insert) {
+    struct State {
+        explicit State(U64 nEntries) : tt(nEntries) {}
+        TranspositionTable tt;
+        Random rnd { 17 };
+    };
+    U64 nEntries = TranspositionTable::numEntriesForSize((U64)sizeMB << 20);
+    auto s = std::make_shared<State>(nEntries);
+    Move m(Square(E2), Square(E4), Piece::EMPTY);
+    for (U64 i = 0; i < nEntries; i++)
+        s->tt.insert(s->rnd.nextU64(), m, TType::T_EXACT, 0, (int)(i % 20), 0);
+    return [s,insert,m]() {
+        const int n = 10000;
+        S64 sum = 0;
+        TranspositionTable::TTEntry ent;
+        for (int i = 0; i < n; i++) {
+            U64 key = s->rnd.nextU64();
+            if (insert) {
+                s->tt.insert(key, m, TType::T_GE, 0, i % 20, 0);
+            } else {
+                s->tt.probe(key, ent);
+                sum += ent.getType();
+            }
+        }
+        sink = sum;
+        return (S64)n;
+    };
+}
+
+static BenchFunc
+nnEvalBench(bool incremental) {
+    struct State {
+        std::vector<Position> positions = getPositions();
+        std::vector<MoveList> moves = getLegalMoves(positions);
+        std::unique_ptr<Evaluate::EvalHashTables> et = Evaluate::getEvalHashTables();
+    };
+    auto s = std::make_shared<State>();
+    return [s,incremental]() {
+        S64 n = 0;
+        S64 sum = 0;
+        NNEvaluator& nnEval = *s->et->nnEval;
+        for (size_t i = 0; i < s->positions.size(); i++) {
+            Position& pos = s->positions[i];
+            nnEval.connectPosition(&pos);
+            nnEval.eval();
+            const MoveList& moves = s->moves[i];
+            UndoInfo ui;
+            for (int mi = 0; mi < moves.size; mi++) {
+                pos.makeMove(moves[mi], ui);
+                if (!incremental)
+                    nnEval.forceFullEval();
+                sum += nnEval.eval();
+                pos.unMakeMove(moves[mi], ui);
+                n++;
+            }
+        }
+        nnEval.connectPosition(nullptr);
+        sink = sum;
+        return n;
+    };
+}
+
+static BenchFunc
+nnEvalBatchBench() {
+    struct State {
+        std::vector<Position> positions;
+        std::vector<int> scores;
+        std::unique_ptr<Evaluate::EvalHashTables> et = Evaluate::getEvalHashTables();
+    };
+    auto s = std::make_shared<State>();
+    std::vector<Position> positions = getPositions();
+    std::vector<MoveList> moves = getLegalMoves(positions);
+    for (size_t i = 0; i < positions.size(); i++) {
+        Position& pos = positions[i];
+        UndoInfo ui;
+        for (int mi = 0; mi < moves[i].size; mi++) {
+            pos.makeMove(moves[i][mi], ui);
+            s->positions.push_back(pos);
+            pos.unMakeMove(moves[i][mi], ui);
+        }
+    }
+    s->scores.resize(s->positions.size());
+    return [s]() {
+        const int n = s->positions.size();
+        s->et->nnEval->evalBatch(&s->positions[0], n, &s->scores[0]);
+        S64 sum = 0;
+        for (int score : s->scores)
+            sum += score;
+        sink = sum;
+        return (S64)n;
+    };
+}
+
+static std::vector<BenchCase>
+getBenchCases() {
+    std::vector<BenchCase> cases;
+    cases.push_back({"movegen", moveGenBench});
+    cases.push_back({"legalmoves", []() { return legalMoveGenBench(false); }});
+    cases.push_back({"removeillegal", []() { return legalMoveGenBench(true); }});
+    cases.push_back({"makemove", makeMoveBench});
+    cases.push_back({"see", seeBench});
+    for (int sizeMB : {1, 16, 256}) {
+        cases.push_back({"ttprobe" + num2Str(sizeMB), [sizeMB]() { return ttBench(sizeMB, false); }});
+        cases.push_back({"ttinsert" + num2Str(sizeMB), [sizeMB]() { return ttBench(sizeMB, true); }});
+    }
+    cases.push_back({"nneval", []() { return nnEvalBench(true); }});
+    cases.push_back({"nnevalfull", []() { return nnEvalBench(false); }});
+    cases.push_back({"nnevalbatch", nnEvalBatchBench});
+    return cases;
+}
+
+/** Run one benchmark case and print time per operation. */
+static void
+runBench(const BenchCase& bc, int nSamples, double sampleTime) {
+    BenchFunc f = bc.setup();
+
+    // Warm up and determine number of batches per sample
+    int nBatches = 1;
+    while (true) {
+        double t0 = currentTime();
+        for (int i = 0; i < nBatches; i++)
+            f();
+        double t = currentTime() - t0;
+        if (t >= sampleTime / 4)
+            break;
+        nBatches *= 2;
+    }
+
+    SampleStatistics stat;
+    for (int s = 0; s < nSamples; s++) {
+        S64 nOps = 0;
+        double t0 = currentTime();
+        for (int i = 0; i < nBatches; i++)
+            nOps += f();
+        double t = currentTime() - t0;
+        stat.addSample(t * 1e9 / nOps);
+    }
+    std::stringstream ss;
+    ss << std::left << std::setw(12) << bc.name << std::right
+       << std::fixed << std::setprecision(2)
+       << std::setw(12) << stat.avg() << " ns/op"
+       << " +- " << std::setw(8) << stat.std()
+       << " (" << (stat.avg() > 0 ? 100 * stat.std() / stat.avg() : 0.0) << "%)";
+    std::cout << ss.str() << std::endl;
+}
+
+static void
+usage() {
+    std::cerr << "Usage: texelbench [-n samples] [-t sampleTime] [case ...]" << std::endl;
+    std::cerr << "Cases:";
+    for (const BenchCase& bc : getBenchCases())
+        std::cerr << ' ' << bc.name;
+    std::cerr << std::endl;
+    ::exit(2);
+}
+
+/** Microbenchmark for the most performance critical engine primitives. */
+int main(int argc, char* argv[]) {
+    ComputerPlayer::initEngine();
+
+    int nSamples = 10;
+    double sampleTime = 0.1;
+    std::vector<std::string> selected;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc) {
+            if (!str2Num(argv[++i], nSamples) || nSamples < 2)
+                usage();
+        } else if (arg == "-t" && i + 1 < argc) {
+            if (!str2Num(argv[++i], sampleTime) || sampleTime <= 0)
+                usage();
+        } else if (startsWith(arg, "-")) {
+            usage();
+        } else {
+            selected.push_back(arg);
+        }
+    }
+
+    std::vector<BenchCase> cases = getBenchCases();
+    for (const std::string& name : selected) {
+        if (std::none_of(cases.begin(), cases.end(),
+                         [&name](const BenchCase& bc) { return bc.name == name; }))
+            usage();
+    }
+    for (const BenchCase& bc : cases)
+        if (selected.empty() || contains(selected, bc.name))
+            runBench(bc, nSamples, sampleTime);
+    return 0;
+}
@@ -28,6 +28,7 @@
 #include "humanPlayer.hpp"
 #include "evaluate.hpp"
 #include "moveGen.hpp"
+#include "perft.hpp"
 #include "textio.hpp"
 #include "timeUtil.hpp"
 #include "evaluateTest.hpp"
@@ -433,6 +434,46 @@ GameTest::testPerfT() {
     doTestPerfTExtensive(game.pos, 3, n3);
 }
 
+TEST(GameTest, testPerftThreaded) {
+    struct Data {
+        std::string fen;
+        int depth;
+        U64 nodes;
+    };
+    std::vector<Data> data = {
+        { TextIO::startPosFEN, 5, 4865609 },
+        { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+        { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    };
+    Perft reference(1, 0);
+    for (int nThreads : { 1, 4 }) {
+        for (int hashMB : { 0, 1 }) {
+            Perft perft(nThreads, hashMB);
+            for (const Data& d : data) {
+                Position pos = TextIO::readFEN(d.fen);
+                std::vector<Perft::MoveCount> divide;
+                EXPECT_EQ(d.nodes, perft.compute(pos, d.depth, &divide));
+                MoveList moves;
+                MoveGen::legalMoves(pos, moves);
+                ASSERT_EQ(moves.size, (int)divide.size());
+                UndoInfo ui;
+                U64 sum = 0;
+                for (int mi = 0; mi < moves.size; mi++) {
+                    EXPECT_EQ(moves[mi], divide[mi].move);
+                    pos.makeMove(moves[mi], ui);
+                    EXPECT_EQ(reference.compute(pos, d.depth - 1), divide[mi].nodes);
+                    pos.unMakeMove(moves[mi], ui);
+                    sum += divide[mi].nodes;
+                }
+                EXPECT_EQ(d.nodes, sum);
+            }
+        }
+    }
+    Perft perft(2, 1);
+    EXPECT_EQ(1, perft.compute(TextIO::readFEN(TextIO::startPosFEN), 0));
+    EXPECT_EQ(20, perft.compute(TextIO::readFEN(TextIO::startPosFEN), 1));
+}
+
 void
 GameTest::doTestPerfTFast(Position& pos, int maxDepth, U64 expectedNodeCounts[]) {
     for (int d = 1; d <= maxDepth; d++) {
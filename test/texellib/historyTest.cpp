@@ -56,3 +56,94 @@ TEST(HistoryTest, testGetHistScore) {
     ASSERT_EQ(2 * 49 / 4, hs.getHistScore(pos, m1));
     ASSERT_EQ(1 * 49 / 1, hs.getHistScore(pos, m2));
 }
+
+TEST(HistoryTest, testContHistScore) {
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    Move e4 = TextIO::stringToMove(pos, "e4");
+    Move d4 = TextIO::stringToMove(pos, "d4");
+    UndoInfo ui;
+    pos.makeMove(e4, ui);
+    const int prevE4 = History::getContext(pos, e4);
+    const int prevD4 = History::getContext(pos, d4);
+    ASSERT_GE(prevE4, 0);
+    ASSERT_GE(prevD4, 0);
+    ASSERT_NE(prevE4, prevD4);
+    ASSERT_EQ(-1, History::getContext(pos, Move()));
+
+    History hs;
+    Move m1 = TextIO::stringToMove(pos, "e5");
+    Move m2 = TextIO::stringToMove(pos, "c5");
+    ASSERT_EQ(0, hs.getHistScore(pos, m1, prevE4));
+    ASSERT_EQ(0, hs.getHistScore(pos, m1, prevE4, prevD4));
+
+    // Success updates both the plain and the continuation history
+    hs.addSuccess(pos, m1, 1, prevE4);
+    ASSERT_EQ(49, hs.getHistScore(pos, m1));
+    ASSERT_EQ(49, hs.getHistScore(pos, m1, prevE4));
+    ASSERT_EQ(49, hs.getHistScore(pos, m1, prevD4));
+    ASSERT_EQ(0, hs.getHistScore(pos, m2, prevE4));
+
+    // Failure without context only updates the plain history
+    hs.addFail(pos, m1, 1);
+    ASSERT_EQ(24, hs.getHistScore(pos, m1));
+    ASSERT_EQ((2 * 24 + 49 + 24) / 4, hs.getHistScore(pos, m1, prevE4));
+    ASSERT_EQ((2 * 24 + 24 + 49) / 4, hs.getHistScore(pos, m1, -1, prevE4));
+    ASSERT_EQ((2 * 24 + 49 + 49) / 4, hs.getHistScore(pos, m1, prevE4, prevE4));
+    ASSERT_EQ(24, hs.getHistScore(pos, m1, prevD4));
+
+    // Failure in the prevD4 context
+    hs.addFail(pos, m1, 1, prevD4);
+    ASSERT_EQ(16, hs.getHistScore(pos, m1));
+    ASSERT_EQ((2 * 16 + 0 + 16) / 4, hs.getHistScore(pos, m1, prevD4));
+    ASSERT_EQ((2 * 16 + 49 + 0) / 4, hs.getHistScore(pos, m1, prevE4, prevD4));
+
+    hs.init();
+    ASSERT_EQ(0, hs.getHistScore(pos, m1, prevE4));
+}
+
+TEST(HistoryTest, testCounterMove) {
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    Move e4 = TextIO::stringToMove(pos, "e4");
+    UndoInfo ui;
+    pos.makeMove(e4, ui);
+    const int prev = History::getContext(pos, e4);
+    Move m1 = TextIO::stringToMove(pos, "e5");
+    Move m2 = TextIO::stringToMove(pos, "c5");
+
+    History hs;
+    ASSERT_FALSE(hs.isCounterMove(prev, m1));
+    hs.setCounterMove(prev, m1);
+    ASSERT_TRUE(hs.isCounterMove(prev, m1));
+    ASSERT_FALSE(hs.isCounterMove(prev, m2));
+    ASSERT_FALSE(hs.isCounterMove(-1, m1));
+
+    hs.setCounterMove(prev, m2);
+    ASSERT_FALSE(hs.isCounterMove(prev, m1));
+    ASSERT_TRUE(hs.isCounterMove(prev, m2));
+
+    hs.setCounterMove(-1, m1);
+    ASSERT_TRUE(hs.isCounterMove(prev, m2));
+
+    hs.init();
+    ASSERT_FALSE(hs.isCounterMove(prev, m2));
+}
+
+TEST(HistoryTest, testCaptureHistScore) {
+    Position pos = TextIO::readFEN("4k3/8/8/3p4/4P3/2N5/8/4K3 w - - 0 1");
+    History hs;
+    Move m1 = TextIO::stringToMove(pos, "exd5");
+    Move m2 = TextIO::stringToMove(pos, "Nxd5");
+    ASSERT_EQ(0, hs.getCaptureHistScore(pos, m1));
+    ASSERT_EQ(0, hs.getCaptureHistScore(pos, m2));
+
+    hs.addCaptureSuccess(pos, m2, 0);
+    ASSERT_EQ(0, hs.getCaptureHistScore(pos, m1));
+    ASSERT_EQ(49, hs.getCaptureHistScore(pos, m2));
+    ASSERT_EQ(0, hs.getHistScore(pos, m2));
+
+    hs.addCaptureFail(pos, m2, 0);
+    ASSERT_EQ(49 / 2, hs.getCaptureHistScore(pos, m2));
+
+    hs.init();
+    ASSERT_EQ(0, hs.getCaptureHistScore(pos, m2));
+}
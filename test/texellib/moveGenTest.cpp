@@ -28,6 +28,7 @@
 #include "posutil.hpp"
 
 #include <vector>
+#include <algorithm>
 #include <iostream>
 
 #include "gtest/gtest.h"
@@ -70,6 +71,60 @@ getCaptureList(Position& pos, bool includeChecks, bool onlyLegal) {
     return strMoves;
 }
 
+/** Check that pseudoLegalCaptures() and pseudoLegalNonCaptures() together
+ *  generate the pseudo-legal moves, and that isPseudoLegal() accepts exactly
+ *  the pseudo-legal moves. */
+static void
+checkStagedMoves(const Position& pos) {
+    MoveList moves, split;
+    MoveGen::pseudoLegalMoves(pos, moves);
+    MoveGen::pseudoLegalCaptures(pos, split);
+    MoveGen::pseudoLegalNonCaptures(pos, split);
+    auto toStrings = [](const MoveList& moves) {
+        std::vector<std::string> ret;
+        for (int mi = 0; mi < moves.size; mi++)
+            ret.push_back(TextIO::moveToUCIString(moves[mi]));
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    };
+    EXPECT_EQ(toStrings(moves), toStrings(split)) << TextIO::toFEN(pos);
+
+    std::vector<Move> moveVec;
+    for (int mi = 0; mi < moves.size; mi++)
+        moveVec.push_back(moves[mi]);
+    const bool wtm = pos.isWhiteMove();
+    const int promotions[] = { Piece::EMPTY,
+                               wtm ? Piece::WQUEEN : Piece::BQUEEN,
+                               wtm ? Piece::WROOK : Piece::BROOK,
+                               wtm ? Piece::WBISHOP : Piece::BBISHOP,
+                               wtm ? Piece::WKNIGHT : Piece::BKNIGHT,
+                               wtm ? Piece::BQUEEN : Piece::WQUEEN,
+                               wtm ? Piece::WKING : Piece::BKING };
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            for (int prom : promotions) {
+                Move m(Square(from), Square(to), prom);
+                bool expected = std::find(moveVec.begin(), moveVec.end(), m) != moveVec.end();
+                ASSERT_EQ(expected, MoveGen::isPseudoLegal(pos, m))
+                    << TextIO::toFEN(pos) << " move: " << TextIO::moveToUCIString(m);
+            }
+        }
+    }
+}
+
+/** Check that legalMoves() generates the same moves in the same order as
+ *  pseudoLegalMoves() followed by removeIllegal(). */
+static void
+checkLegalMoves(Position& pos) {
+    MoveList expected, moves;
+    MoveGen::pseudoLegalMoves(pos, expected);
+    MoveGen::removeIllegal(pos, expected);
+    MoveGen::legalMoves(pos, moves);
+    ASSERT_EQ(expected.size, moves.size) << TextIO::toFEN(pos);
+    for (int mi = 0; mi < moves.size; mi++)
+        ASSERT_EQ(expected[mi], moves[mi]) << TextIO::toFEN(pos) << " mi: " << mi;
+}
+
 static std::vector<std::string>
 getCheckEvasions(Position& pos, bool onlyLegal) {
     std::vector<std::string> strMoves;
@@ -102,6 +157,8 @@ getMoveList0(Position& pos, bool onlyLegal) {
 
     std::vector<std::string> capList1 = getCaptureList(pos, false, onlyLegal);
     EXPECT_TRUE(containsAll(strMoves, capList1));
+    checkStagedMoves(pos);
+    checkLegalMoves(pos);
 
     std::vector<std::string> capList2 = getCaptureList(pos, true, onlyLegal);
     EXPECT_TRUE(containsAll(strMoves, capList2));
@@ -508,3 +565,68 @@ TEST(MoveGenTest, testCheckEvasions) {
     std::vector<std::string> evList = getCheckEvasions(pos, false);
     EXPECT_TRUE(contains(evList, "b7c6"));
 }
+
+TEST(MoveGenTest, testStagedMoves) {
+    const std::vector<std::string> fens = {
+        TextIO::startPosFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    };
+    for (const std::string& fen : fens) {
+        Position pos = TextIO::readFEN(fen);
+        checkStagedMoves(pos);
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(pos, moves);
+        MoveGen::removeIllegal(pos, moves);
+        UndoInfo ui;
+        for (int mi = 0; mi < moves.size; mi++) {
+            pos.makeMove(moves[mi], ui);
+            checkStagedMoves(pos);
+            pos.unMakeMove(moves[mi], ui);
+        }
+    }
+}
+
+static U64
+legalPerfT(Position& pos, int depth) {
+    checkLegalMoves(pos);
+    MoveList moves;
+    MoveGen::legalMoves(pos, moves);
+    if (depth <= 1)
+        return moves.size;
+    U64 nodes = 0;
+    UndoInfo ui;
+    for (int mi = 0; mi < moves.size; mi++) {
+        pos.makeMove(moves[mi], ui);
+        nodes += legalPerfT(pos, depth - 1);
+        pos.unMakeMove(moves[mi], ui);
+    }
+    return nodes;
+}
+
+TEST(MoveGenTest, testLegalMoves) {
+    // Pins, double checks, castling through attacked squares and en passant
+    // captures that expose the king
+    Position pos = TextIO::readFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    EXPECT_EQ(97862, legalPerfT(pos, 3));
+    pos = TextIO::readFEN("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    EXPECT_EQ(43238, legalPerfT(pos, 4));
+    pos = TextIO::readFEN("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    EXPECT_EQ(9467, legalPerfT(pos, 3));
+    pos = TextIO::readFEN("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    EXPECT_EQ(62379, legalPerfT(pos, 3));
+
+    pos = TextIO::readFEN("8/8/8/KPp4r/8/8/8/7k w - c6 0 1");
+    std::vector<std::string> strMoves = getMoveList(pos, true);
+    EXPECT_FALSE(contains(strMoves, "b5c6"));
+    pos = TextIO::readFEN("4k3/8/8/8/1b6/8/3P4/4K3 w - - 0 1");
+    strMoves = getMoveList(pos, true);
+    EXPECT_FALSE(contains(strMoves, "d2d3"));
+    EXPECT_FALSE(contains(strMoves, "d2d4"));
+    pos = TextIO::readFEN("4k3/8/8/8/8/5n2/8/R3K2r w Q - 0 1");
+    strMoves = getMoveList(pos, true);
+    EXPECT_EQ(2, strMoves.size());
+}
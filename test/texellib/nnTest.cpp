@@ -29,10 +29,17 @@
 #include "vectorop.hpp"
 #include "textio.hpp"
 #include "position.hpp"
+#include "moveGen.hpp"
 #include "evaluate.hpp"
+#include "nneval.hpp"
+#include "chessError.hpp"
+#include "random.hpp"
+#include "tempFile.hpp"
 
 #include <vector>
 #include <string>
+#include <fstream>
+#include <sstream>
 
 #include "gtest/gtest.h"
 
@@ -277,3 +284,280 @@ NNTest::testIncremental() {
           ":e", "Nc3", ":e", "Nc6", ":e", "Rb1", ":e", "Rb8", ":e",
          });
 }
+
+TEST(NNTest, testRefreshCache) {
+    NNTest::testRefreshCache();
+}
+
+void
+NNTest::testRefreshCache() {
+    const std::vector<std::string> fens = {
+        TextIO::startPosFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+        "8/4k3/2b5/8/8/3BPN2/4K3/8 w - - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R4K1R b kq - 1 10",
+        "2r1r3/1p1q2kp/p1nP1pp1/3B1b2/5P2/B1Q3P1/7P/R3R1K1 w - - 0 1",
+        "4k3/8/8/8/8/8/8/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "8/4k3/2b5/8/8/3BPN2/4K3/8 w - - 0 1",
+    };
+    auto et = Evaluate::getEvalHashTables();
+    NNEvaluator& cachedEval = *et->nnEval;
+    for (int rep = 0; rep < 2; rep++) {
+        for (const std::string& fen : fens) {
+            Position pos = TextIO::readFEN(fen);
+            cachedEval.connectPosition(&pos);
+            int score1 = cachedEval.eval();
+            cachedEval.connectPosition(nullptr);
+
+            auto et2 = Evaluate::getEvalHashTables();
+            et2->nnEval->connectPosition(&pos);
+            int score2 = et2->nnEval->eval();
+            et2->nnEval->connectPosition(nullptr);
+            ASSERT_EQ(score2, score1) << "fen: " << fen;
+        }
+    }
+}
+
+TEST(NNTest, testEvalBatch) {
+    NNTest::testEvalBatch();
+}
+
+void
+NNTest::testEvalBatch() {
+    const std::vector<std::string> fens = {
+        TextIO::startPosFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+        "8/4k3/2b5/8/8/3BPN2/4K3/8 w - - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R4K1R b kq - 1 10",
+        "2r1r3/1p1q2kp/p1nP1pp1/3B1b2/5P2/B1Q3P1/7P/R3R1K1 w - - 0 1",
+        "4k3/8/8/8/8/8/8/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    };
+    std::vector<Position> positions;
+    for (int rep = 0; rep < 5; rep++)
+        for (int i = 0; i < (int)fens.size(); i++)
+            positions.push_back(TextIO::readFEN(fens[(i * (rep + 1)) % fens.size()]));
+    const int n = positions.size();
+    ASSERT_GT(n, NNKernels::batchSize * 2);
+
+    auto et = Evaluate::getEvalHashTables();
+    NNEvaluator& nnEval = *et->nnEval;
+    std::vector<int> expected(n);
+    for (int i = 0; i < n; i++) {
+        nnEval.connectPosition(&positions[i]);
+        expected[i] = nnEval.eval();
+    }
+
+    Position connected = TextIO::readFEN(fens[1]);
+    nnEval.connectPosition(&connected);
+    int connectedScore = nnEval.eval();
+
+    for (int len : { n, 1, NNKernels::batchSize, NNKernels::batchSize + 1 }) {
+        std::vector<int> scores(len);
+        nnEval.evalBatch(&positions[0], len, &scores[0]);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(expected[i], scores[i]) << "len: " << len << " i: " << i;
+    }
+
+    EXPECT_EQ(connectedScore, nnEval.eval());
+    nnEval.connectPosition(nullptr);
+}
+
+TEST(NNTest, testWeight1S8) {
+    NNTest::testWeight1S8();
+}
+
+void
+NNTest::testWeight1S8() {
+    // Create a network where all first layer weights in column j are multiples
+    // of a scale factor, so that conversion to 8-bit weights is exact.
+    const int n1 = NetData::n1;
+    auto createNet = []() {
+        std::shared_ptr<NetData> net = NetData::create();
+        Random rnd(4711);
+        for (int i = 0; i < NetData::inFeatures; i++)
+            for (int j = 0; j < n1; j++)
+                net->weight1(i, j) = (rnd.nextInt(255) - 127) * (1 + j % 4);
+        for (int j = 0; j < n1; j++)
+            net->weight1(j, j) = 127 * (1 + j % 4);
+        for (auto& b : net->bias1.data)   b = rnd.nextInt(512) - 256;
+        for (auto& w : net->lin2.weight.data) w = rnd.nextInt(64) - 32;
+        for (auto& b : net->lin2.bias.data)   b = rnd.nextInt(64) - 32;
+        for (auto& w : net->lin3.weight.data) w = rnd.nextInt(64) - 32;
+        for (auto& b : net->lin3.bias.data)   b = rnd.nextInt(64) - 32;
+        for (auto& w : net->lin4.weight.data) w = rnd.nextInt(64) - 32;
+        for (auto& b : net->lin4.bias.data)   b = rnd.nextInt(64) - 32;
+        return net;
+    };
+    std::shared_ptr<NetData> net = createNet();
+    std::shared_ptr<NetData> net8 = createNet();
+    EXPECT_FALSE(net8->weight1S8);
+    net8->quantizeWeight1();
+    EXPECT_TRUE(net8->weight1S8);
+    for (int j = 0; j < n1; j++)
+        ASSERT_EQ(1 + j % 4, net8->scale1(j));
+    for (int i = 0; i < NetData::inFeatures; i++)
+        for (int j = 0; j < n1; j++)
+            ASSERT_EQ(net->getWeight1(i, j), net8->getWeight1(i, j));
+
+    // Serialization round trip
+    std::stringstream ss8;
+    net8->save(ss8);
+    EXPECT_EQ(net8->computeSize(), (int)ss8.str().size());
+    EXPECT_LT(net8->computeSize(), net->computeSize());
+    std::shared_ptr<NetData> net8b = NetData::create();
+    net8b->load(ss8);
+    EXPECT_TRUE(net8b->weight1S8);
+    net8->prepareMatMul();
+    EXPECT_EQ(net8->computeHash(), net8b->computeHash());
+
+    // Evaluation, including incremental updates, must match the 16-bit network
+    net->prepareMatMul();
+    auto eval16 = NNEvaluator::create(*net);
+    auto eval8 = NNEvaluator::create(*net8b);
+    const std::vector<std::string> fens = {
+        TextIO::startPosFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+        "8/4k3/2b5/8/8/3BPN2/4K3/8 w - - 0 1",
+    };
+    std::vector<Position> batch;
+    for (const std::string& fen : fens) {
+        Position pos16 = TextIO::readFEN(fen);
+        Position pos8 = TextIO::readFEN(fen);
+        eval16->connectPosition(&pos16);
+        eval8->connectPosition(&pos8);
+        ASSERT_EQ(eval16->eval(), eval8->eval()) << "fen: " << fen;
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(pos16, moves);
+        MoveGen::removeIllegal(pos16, moves);
+        UndoInfo ui16, ui8;
+        for (int mi = 0; mi < moves.size; mi++) {
+            pos16.makeMove(moves[mi], ui16);
+            pos8.makeMove(moves[mi], ui8);
+            ASSERT_EQ(eval16->eval(), eval8->eval()) << "fen: " << fen << " move: " << mi;
+            batch.push_back(pos16);
+            pos16.unMakeMove(moves[mi], ui16);
+            pos8.unMakeMove(moves[mi], ui8);
+        }
+        eval16->connectPosition(nullptr);
+        eval8->connectPosition(nullptr);
+    }
+    std::vector<int> scores16(batch.size()), scores8(batch.size());
+    eval16->evalBatch(&batch[0], batch.size(), &scores16[0]);
+    eval8->evalBatch(&batch[0], batch.size(), &scores8[0]);
+    EXPECT_EQ(scores16, scores8);
+}
+
+TEST(NNTest, testImage) {
+    NNTest::testImage();
+}
+
+void
+NNTest::testImage() {
+    TempFile tmpFile("texel_nn_image.bin");
+    const std::string& fileName = tmpFile.getName();
+    const NetData& netData = *Evaluate::EvalHashTables::getNetData();
+    ASSERT_TRUE(netData.saveImage(fileName));
+
+    std::shared_ptr<const NetData> mapped = NetData::mapImage(fileName);
+    ASSERT_TRUE(mapped != nullptr);
+    EXPECT_EQ(netData.computeHash(), mapped->computeHash());
+
+    Position pos = TextIO::readFEN("2r1r3/1p1q2kp/p1nP1pp1/3B1b2/5P2/B1Q3P1/7P/R3R1K1 w - - 0 1");
+    std::shared_ptr<NNEvaluator> eval1 = NNEvaluator::create(netData);
+    std::shared_ptr<NNEvaluator> eval2 = NNEvaluator::create(*mapped);
+    eval1->connectPosition(&pos);
+    int score1 = eval1->eval();
+    eval1->connectPosition(nullptr);
+    eval2->connectPosition(&pos);
+    int score2 = eval2->eval();
+    eval2->connectPosition(nullptr);
+    EXPECT_EQ(score1, score2);
+
+    EXPECT_EQ(nullptr, NetData::mapImage(fileName + ".missing"));
+
+    // Image with corrupt weights is rejected
+    {
+        std::fstream fs(fileName, std::ios::binary | std::ios::in | std::ios::out);
+        fs.seekg(-100, std::ios::end);
+        char c = fs.get();
+        fs.seekp(-100, std::ios::end);
+        fs.put(c ^ 1);
+    }
+    EXPECT_EQ(nullptr, NetData::mapImage(fileName));
+
+    // Truncated image is rejected
+    {
+        std::ofstream os(fileName, std::ios::binary);
+        os << "truncated";
+    }
+    EXPECT_EQ(nullptr, NetData::mapImage(fileName));
+}
+
+TEST(NNTest, testNetFile) {
+    NNTest::testNetFile();
+}
+
+void
+NNTest::testNetFile() {
+    TempFile tmpFile("texel_nn_net.tbin");
+    const std::string& fileName = tmpFile.getName();
+    std::shared_ptr<const NetData> defaultNet = Evaluate::EvalHashTables::getNetData();
+
+    std::shared_ptr<NetData> net = NetData::create();
+    Random rnd(17);
+    for (auto& w : net->weight1.data) w = rnd.nextInt(64) - 32;
+    for (auto& b : net->bias1.data)   b = rnd.nextInt(64) - 32;
+    for (auto& w : net->lin2.weight.data) w = rnd.nextInt(64) - 32;
+    for (auto& b : net->lin2.bias.data)   b = rnd.nextInt(64) - 32;
+    for (auto& w : net->lin3.weight.data) w = rnd.nextInt(64) - 32;
+    for (auto& b : net->lin3.bias.data)   b = rnd.nextInt(64) - 32;
+    for (auto& w : net->lin4.weight.data) w = rnd.nextInt(64) - 32;
+    for (auto& b : net->lin4.bias.data)   b = rnd.nextInt(64) - 32;
+    {
+        std::ofstream os(fileName, std::ios::binary);
+        net->save(os);
+    }
+    net->prepareMatMul();
+
+    auto et = Evaluate::getEvalHashTables();
+    EXPECT_EQ(defaultNet, et->netData);
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    auto evalScore = [&pos](Evaluate::EvalHashTables& et) {
+        Evaluate eval(et);
+        eval.connectPosition(pos);
+        return eval.evalPos();
+    };
+    int defaultScore = evalScore(*et);
+
+    Evaluate::EvalHashTables::setNetFile(fileName);
+    std::shared_ptr<const NetData> fileNet = Evaluate::EvalHashTables::getNetData();
+    EXPECT_NE(defaultNet, fileNet);
+    EXPECT_EQ(net->computeHash(), fileNet->computeHash());
+    EXPECT_EQ(defaultNet, et->netData);
+    et->updateNetData();
+    EXPECT_EQ(fileNet, et->netData);
+    {
+        // Scores cached for the old network must not be used
+        auto et2 = Evaluate::getEvalHashTables();
+        int fileScore = evalScore(*et2);
+        EXPECT_NE(defaultScore, fileScore);
+        EXPECT_EQ(fileScore, evalScore(*et));
+    }
+
+    // Failed load keeps the current network
+    EXPECT_THROW(Evaluate::EvalHashTables::setNetFile(fileName + ".missing"), ChessError);
+    {
+        std::ofstream os(fileName, std::ios::binary);
+        os << "not a network";
+    }
+    EXPECT_THROW(Evaluate::EvalHashTables::setNetFile(fileName), ChessError);
+    EXPECT_EQ(fileNet, Evaluate::EvalHashTables::getNetData());
+
+    Evaluate::EvalHashTables::setNetFile("");
+    EXPECT_EQ(defaultNet, Evaluate::EvalHashTables::getNetData());
+    et->updateNetData();
+    EXPECT_EQ(defaultNet, et->netData);
+}
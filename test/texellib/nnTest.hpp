@@ -33,6 +33,23 @@ public:
 
     /** Test incremental NN evaluation. */
     static void testIncremental();
+
+    /** Test that refreshing from cached king square states gives the same
+     *  result as computing from scratch. */
+    static void testRefreshCache();
+
+    /** Test that batch evaluation gives the same result as evaluating
+     *  one position at a time. */
+    static void testEvalBatch();
+
+    /** Test networks with 8-bit first layer weights. */
+    static void testWeight1S8();
+
+    /** Test saving and mapping network image files. */
+    static void testImage();
+
+    /** Test switching to a network loaded from a file. */
+    static void testNetFile();
 };
 
 #endif /* NNTEST_HPP_ */
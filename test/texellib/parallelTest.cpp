@@ -25,9 +25,11 @@
 
 #define _GLIBCXX_USE_NANOSLEEP
 
+#include "parallelTest.hpp"
 #include "searchTest.hpp"
 #include "parallel.hpp"
 #include "clustertt.hpp"
+#include "socketTransport.hpp"
 #include "position.hpp"
 #include "textio.hpp"
 #include "searchUtil.hpp"
@@ -37,6 +39,12 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#ifdef CLUSTER_SOCKETS
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 #include "gtest/gtest.h"
 
@@ -300,3 +308,243 @@ TEST(ParallelTest, testCommunicator) {
     root.poll(h0);
     ASSERT_EQ(2, h0.getNStopAck());
 }
+
+TEST(ParallelTest, testWorkerSubTrees) {
+    ParallelTest::testWorkerSubTrees();
+}
+
+void
+ParallelTest::testWorkerSubTrees() {
+    using SubTrees = std::vector<std::vector<int>>;
+    auto getSubTrees = [](const std::vector<int>& threads,
+                          std::function<int(int)> nodeForThread,
+                          std::function<bool(int)> isSmtThread) {
+        SubTrees subTrees;
+        WorkerThread::getSubTrees(threads, nodeForThread, isSmtThread, subTrees);
+        return subTrees;
+    };
+    auto oneNode = [](int t) { return -1; };
+    auto noSmt = [](int t) { return false; };
+
+    ASSERT_EQ(SubTrees{}, getSubTrees({}, oneNode, noSmt));
+    ASSERT_EQ((SubTrees{{1},{2}}), getSubTrees({1,2}, oneNode, noSmt));
+
+    // At most 4 children, subtree sizes as equal as possible
+    ASSERT_EQ((SubTrees{{1,2,3},{4,5},{6,7},{8,9}}),
+              getSubTrees({1,2,3,4,5,6,7,8,9}, oneNode, noSmt));
+
+    // Threads on separate cores come before hyperthread siblings
+    auto oddSmt = [](int t) { return t % 2 == 1; };
+    ASSERT_EQ((SubTrees{{2,4},{6,1},{3},{5}}),
+              getSubTrees({1,2,3,4,5,6}, oneNode, oddSmt));
+
+    // One subtree for each NUMA node, rooted at a thread on a separate core
+    auto twoNodes = [](int t) { return t < 4 ? 0 : 1; };
+    auto someSmt = [](int t) { return t == 1 || t == 5; };
+    ASSERT_EQ((SubTrees{{2,3,1},{4,6,7,5}}),
+              getSubTrees({1,2,3,4,5,6,7}, twoNodes, someSmt));
+
+    // Node order follows the first thread of each node
+    auto threeNodes = [](int t) { return (t + 1) % 3; };
+    ASSERT_EQ((SubTrees{{1,4,7},{2,5,8},{3,6}}),
+              getSubTrees({1,2,3,4,5,6,7,8}, threeNodes, noSmt));
+}
+
+TEST(ParallelTest, testSPSCQueue) {
+    {
+        SPSCQueue<int, 4> q;
+        int e;
+        ASSERT_FALSE(q.pop(e));
+        for (int i = 0; i < 4; i++)
+            ASSERT_TRUE(q.push(int(i)));
+        ASSERT_FALSE(q.push(4));
+        ASSERT_TRUE(q.pop(e));
+        ASSERT_EQ(0, e);
+        ASSERT_TRUE(q.push(4));
+        for (int i = 1; i <= 4; i++) {
+            ASSERT_TRUE(q.pop(e));
+            ASSERT_EQ(i, e);
+        }
+        ASSERT_FALSE(q.pop(e));
+    }
+    {
+        SPSCQueue<int, 16> q;
+        const int n = 100000;
+        std::thread producer([&q]() {
+            for (int i = 0; i < n; i++)
+                while (!q.push(int(i)))
+                    std::this_thread::yield();
+        });
+        int expected = 0;
+        while (expected < n) {
+            int e;
+            if (q.pop(e)) {
+                EXPECT_EQ(expected, e);
+                expected++;
+            } else
+                std::this_thread::yield();
+        }
+        producer.join();
+        int e;
+        ASSERT_FALSE(q.pop(e));
+    }
+}
+
+TEST(ParallelTest, testDeterministicScheduler) {
+    DeterministicScheduler& sched = DeterministicScheduler::instance();
+    ASSERT_FALSE(sched.isActive());
+    ASSERT_FALSE(sched.waitTurn(1));
+
+    const int nTurns = 5;
+    std::vector<int> order;
+    auto worker = [&sched,&order](int threadNo) {
+        while (!sched.isActive())
+            std::this_thread::yield();
+        for (int i = 0; i < nTurns; i++) {
+            sched.waitTurn(threadNo);
+            order.push_back(threadNo);
+            sched.passTurn(threadNo);
+        }
+    };
+    std::thread t1(worker, 1);
+    std::thread t2(worker, 2);
+    sched.activate(3);
+    for (int i = 0; i < nTurns; i++) {
+        order.push_back(0);
+        sched.yield(0);
+    }
+    t1.join();
+    t2.join();
+    sched.deactivate();
+    ASSERT_FALSE(sched.isActive());
+
+    std::vector<int> expected;
+    for (int i = 0; i < nTurns; i++)
+        for (int t = 0; t < 3; t++)
+            expected.push_back(t);
+    ASSERT_EQ(expected, order);
+}
+
+#ifdef CLUSTER_SOCKETS
+TEST(ParallelTest, testSocketTransport) {
+    std::string prefix = "/tmp/texeltest" + num2Str(getpid()) + "_";
+    std::vector<std::string> addrs { "unix:" + prefix + "0", "unix:" + prefix + "1",
+                                     "127.0.0.1:1" };
+    SocketTransport st[3];
+    for (int i = 0; i < 3; i++)
+        ASSERT_TRUE(st[i].setNodes(addrs, i));
+    ASSERT_EQ(3, st[0].getNumberOfNodes());
+    ASSERT_FALSE(st[0].setNodes(addrs, 3));
+    ASSERT_FALSE(st[0].setNodes({ "unix:/tmp/a", "noport" }, 0));
+    ASSERT_TRUE(st[0].setNodes(addrs, 0));
+
+    // Children may connect before the parent listens
+    bool ok1 = false, ok2 = false;
+    std::thread t1([&]() { ok1 = st[1].connect(0, {}); });
+    std::thread t2([&]() { ok2 = st[2].connect(0, {}); });
+    bool ok0 = st[0].connect(-1, { 1, 2 });
+    t1.join();
+    t2.join();
+    ASSERT_TRUE(ok0);
+    ASSERT_TRUE(ok1);
+    ASSERT_TRUE(ok2);
+
+    // Many messages of varying size, larger than the socket buffers in total
+    const int nMsg = 2000;
+    std::vector<U8> buf(MAX_CLUSTER_BUF_SIZE);
+    for (int m = 0; m < nMsg; m++) {
+        int len = (m * 37) % MAX_CLUSTER_BUF_SIZE;
+        for (int i = 0; i < len; i++)
+            buf[i] = (U8)(m + i);
+        st[1].send(0, buf.data(), len);
+    }
+    std::vector<U8> rBuf(MAX_CLUSTER_BUF_SIZE);
+    int len;
+    ASSERT_FALSE(st[2].recv(0, rBuf.data(), rBuf.size(), len));
+    for (int m = 0; m < nMsg; m++) {
+        while (!st[0].recv(1, rBuf.data(), rBuf.size(), len))
+            st[1].flush(0);
+        ASSERT_EQ((m * 37) % MAX_CLUSTER_BUF_SIZE, len);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ((U8)(m + i), rBuf[i]);
+    }
+    ASSERT_TRUE(st[1].flush(0));
+    ASSERT_FALSE(st[0].recv(1, rBuf.data(), rBuf.size(), len));
+
+    std::vector<U8> data { 1, 2, 3 };
+    st[0].sendBlocking(2, data.data(), data.size());
+    ASSERT_EQ(3, st[2].recvBlocking(0, rBuf.data(), rBuf.size()));
+    ASSERT_EQ(data, std::vector<U8>(rBuf.begin(), rBuf.begin() + 3));
+
+    // A message larger than the receive buffer closes the connection
+    st[0].sendBlocking(1, rBuf.data(), 100);
+    ASSERT_EQ(-1, st[1].recvBlocking(0, rBuf.data(), 99));
+
+    ASSERT_FALSE(st[1].isConnected(0));
+
+    // Received data is still available after the peer has closed the connection
+    st[2].sendBlocking(0, data.data(), data.size());
+    ASSERT_TRUE(st[0].isConnected(2));
+    st[2].close();
+    ASSERT_EQ(3, st[0].recvBlocking(2, rBuf.data(), rBuf.size()));
+    ASSERT_EQ(-1, st[0].recvBlocking(2, rBuf.data(), rBuf.size()));
+    ASSERT_FALSE(st[0].isConnected(2));
+}
+
+TEST(ParallelTest, testSocketTransportHandshake) {
+    std::string prefix = "/tmp/texeltest" + num2Str(getpid()) + "_hs";
+    std::vector<std::string> addrs { "unix:" + prefix + "0", "unix:" + prefix + "1",
+                                     "unix:" + prefix + "2" };
+    SocketTransport st[3];
+    for (int i = 0; i < 3; i++)
+        ASSERT_TRUE(st[i].setNodes(addrs, i));
+
+    // A client that never sends its node number, and a node that is not a
+    // child of node 0, must not prevent the real child from connecting
+    std::atomic<bool> done(false);
+    std::atomic<bool> silentConnected(false);
+    std::thread silent([&]() {
+        sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strncpy(sa.sun_path, (prefix + "0").c_str(), sizeof(sa.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        for (int i = 0; i < 1000 && !silentConnected; i++) {
+            if (::connect(fd, (sockaddr*)&sa, sizeof(sa)) == 0)
+                silentConnected = true;
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        while (!done)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ::close(fd);
+    });
+    bool ok1 = false, ok2 = false;
+    std::thread t2([&]() {
+        while (!silentConnected && !done)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ok2 = st[2].connect(0, {});
+    });
+    std::thread t1([&]() {
+        while (!silentConnected && !done)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ok1 = st[1].connect(0, {});
+    });
+    bool ok0 = st[0].connect(-1, { 1 });
+    done = true;
+    silent.join();
+    t1.join();
+    t2.join();
+    ASSERT_TRUE(silentConnected);
+    ASSERT_TRUE(ok0);
+    ASSERT_TRUE(ok1);
+    ASSERT_TRUE(ok2);
+    ASSERT_TRUE(st[0].isConnected(1));
+    ASSERT_FALSE(st[0].isConnected(2));
+
+    std::vector<U8> data { 1, 2, 3 };
+    std::vector<U8> rBuf(16);
+    st[1].sendBlocking(0, data.data(), data.size());
+    ASSERT_EQ(3, st[0].recvBlocking(1, rBuf.data(), rBuf.size()));
+}
+#endif
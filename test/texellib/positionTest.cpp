@@ -376,6 +376,30 @@ TEST(PositionTest, testHashCode) {
     }
 }
 
+TEST(PositionTest, testCuckoo) {
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    std::vector<U64> hashList;
+    hashList.push_back(pos.zobristHash());
+    UndoInfo ui;
+    for (const char* m : { "Nf3", "Nf6", "Ng1" }) {
+        pos.makeMove(TextIO::stringToMove(pos, m), ui);
+        hashList.push_back(pos.zobristHash());
+    }
+    Square s1, s2;
+    ASSERT_TRUE(Position::getCuckooMove(hashList[3] ^ hashList[0], s1, s2));
+    ASSERT_EQ(std::min(G8, F6), std::min(s1.asInt(), s2.asInt()));
+    ASSERT_EQ(std::max(G8, F6), std::max(s1.asInt(), s2.asInt()));
+    ASSERT_TRUE(Position::getCuckooMove(hashList[3] ^ hashList[2], s1, s2));
+    ASSERT_EQ(std::min(G1, F3), std::min(s1.asInt(), s2.asInt()));
+    ASSERT_EQ(std::max(G1, F3), std::max(s1.asInt(), s2.asInt()));
+
+    // Not a single reversible move
+    ASSERT_FALSE(Position::getCuckooMove(hashList[3] ^ hashList[1], s1, s2));
+    U64 h = pos.zobristHash();
+    pos.makeMove(TextIO::stringToMove(pos, "e5"), ui);
+    ASSERT_FALSE(Position::getCuckooMove(h ^ pos.zobristHash(), s1, s2));
+}
+
 TEST(PositionTest, testGetKingSq) {
     Position pos = TextIO::readFEN(TextIO::startPosFEN);
     ASSERT_EQ(TextIO::getSquare("e1"), pos.getKingSq(true));
@@ -249,6 +249,50 @@ SearchTest::testDrawRep() {
     EXPECT_EQ(0, score); // Draw, black can not escape from perpetual checks
 }
 
+TEST(SearchTest, testUpcomingRep) {
+    SearchTest::testUpcomingRep();
+}
+
+void
+SearchTest::testUpcomingRep() {
+    auto makeMoves = [](Position& pos, std::vector<U64>& hashList,
+                        const std::vector<std::string>& moves) {
+        UndoInfo ui;
+        for (const std::string& m : moves) {
+            hashList.push_back(pos.zobristHash());
+            pos.makeMove(TextIO::stringToMove(pos, m), ui);
+        }
+    };
+
+    Position pos = TextIO::readFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+    std::vector<U64> hashList;
+    makeMoves(pos, hashList, { "Ra2", "Kd8", "Ra4" });
+    EXPECT_FALSE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 0));
+    makeMoves(pos, hashList, { "Ke8" });
+    // White can play Ra2 to repeat the position after the first move
+    EXPECT_TRUE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 0));
+    EXPECT_TRUE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 1));
+    // Repetition of positions before the search started does not count
+    EXPECT_FALSE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 2));
+
+    // Castling rights differ
+    pos = TextIO::readFEN("r3k3/8/8/8/8/8/8/4K2R w Kq - 0 1");
+    hashList.clear();
+    makeMoves(pos, hashList, { "Kf1", "Kd8", "Ke1", "Ke8" });
+    EXPECT_FALSE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 0));
+
+    // Path for Ra3-a1 blocked
+    pos = TextIO::readFEN("4k3/8/8/8/8/8/P7/1R2K3 w - - 0 1");
+    hashList.clear();
+    makeMoves(pos, hashList, { "Ra1", "Kd8", "Rb1", "Kd7", "Rb3", "Ke7", "Ra3", "Ke8" });
+    EXPECT_FALSE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 0));
+
+    pos = TextIO::readFEN("4k3/8/8/8/8/8/8/1R2K3 w - - 0 1");
+    hashList.clear();
+    makeMoves(pos, hashList, { "Ra1", "Kd8", "Rb1", "Kd7", "Rb3", "Ke7", "Ra3", "Ke8" });
+    EXPECT_TRUE(Search::hasUpcomingRep(pos, hashList, hashList.size(), 0));
+}
+
 TEST(SearchTest, testHashing) {
     SearchTest::testHashing();
 }
@@ -338,7 +382,10 @@ SearchTest::testNullMoveVerification() {
 int
 SearchTest::getSEE(Search& sc, const Move& m) {
     const int mate0 = SearchConst::MATE0;
+    const Position posCopy(sc.pos);
     int see = sc.SEE(m, -mate0, mate0);
+    EXPECT_EQ(posCopy, sc.pos);
+    EXPECT_EQ(see, Search::SEE(posCopy, m, -mate0, mate0));
 
     bool neg = sc.negSEE(m);
     EXPECT_EQ(see < 0, neg);
@@ -617,3 +664,126 @@ SearchTest::testFortress() {
     EXPECT_EQ(TextIO::moveToUCIString(bestM), "c2a4");
     EXPECT_GT(bestM.score(), -600);
 }
+
+TEST(SearchTest, testLazySMP) {
+    SearchTest::testLazySMP();
+}
+
+void
+SearchTest::testLazySMP() {
+    UciParams::smpMode->set("Lazy");
+    {
+        const int nThreads = 4;
+        TranspositionTable tt(512*1024);
+        Notifier notifier;
+        ThreadCommunicator comm(nullptr, tt, notifier, true);
+        KillerTable kt;
+        History ht;
+        auto et = Evaluate::getEvalHashTables();
+        Search::SearchTables st(comm.getCTT(), kt, ht, *et);
+        TreeLogger treeLog;
+
+        comm.sendAssignThreads(nThreads, {});
+        std::vector<std::shared_ptr<WorkerThread>> children;
+        WorkerThread::createWorkers(1, &comm, nThreads - 1, tt, children);
+
+        Position pos = TextIO::readFEN("r2q1rk1/pp2ppbp/2np1np1/8/3NP1b1/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9");
+        Search sc(pos, nullHist, 0, st, comm, treeLog);
+        MoveList moves;
+        MoveGen::legalMoves(pos, moves);
+        sc.scoreMoveList(moves, 0);
+        sc.timeLimit(-1, -1);
+        Move bestM = sc.iterativeDeepening(moves, 8, -1, 1, false, 100);
+        bool legal = false;
+        for (int i = 0; i < moves.size; i++)
+            if (moves[i] == bestM)
+                legal = true;
+        EXPECT_TRUE(legal) << TextIO::moveToUCIString(bestM);
+
+        // Stop the helper threads and verify that they searched
+        comm.sendStopSearch();
+        class Handler : public Communicator::CommandHandler {
+        public:
+            explicit Handler(Communicator& comm) : comm(comm) {}
+            void stopAck() override { comm.sendStopAck(true); }
+        private:
+            Communicator& comm;
+        };
+        Handler handler(comm);
+        comm.sendStopAck(false);
+        while (!comm.hasStopAck()) {
+            comm.poll(handler);
+            notifier.wait(1);
+        }
+        EXPECT_GT(comm.getNumSearchedNodes(), 0);
+    }
+    UciParams::smpMode->set("Jobs");
+}
+
+TEST(SearchTest, testDeterministicSearch) {
+    SearchTest::testDeterministicSearch();
+}
+
+/** Search a position with a node limit, using nThreads threads scheduled
+ *  by DeterministicScheduler, the same way EngineMainThread does it. */
+void
+SearchTest::deterministicSearch(const std::string& fen, int nThreads, int maxNodes,
+                                Move& bestM, S64& nodes) {
+    TranspositionTable tt(512*1024);
+    Notifier notifier;
+    ThreadCommunicator comm(nullptr, tt, notifier, true);
+    KillerTable kt;
+    History ht;
+    auto et = Evaluate::getEvalHashTables();
+    Search::SearchTables st(comm.getCTT(), kt, ht, *et);
+    TreeLogger treeLog;
+
+    comm.sendAssignThreads(nThreads, {});
+    std::vector<std::shared_ptr<WorkerThread>> children;
+    WorkerThread::createWorkers(1, &comm, nThreads - 1, tt, children);
+    DeterministicScheduler& sched = DeterministicScheduler::instance();
+    sched.activate(nThreads);
+
+    Position pos = TextIO::readFEN(fen);
+    Search sc(pos, nullHist, 0, st, comm, treeLog);
+    MoveList moves;
+    MoveGen::legalMoves(pos, moves);
+    sc.scoreMoveList(moves, 0);
+    sc.timeLimit(-1, -1);
+    bestM = sc.iterativeDeepening(moves, -1, maxNodes, 1, false, 100);
+
+    comm.sendStopSearch();
+    class Handler : public Communicator::CommandHandler {
+    public:
+        explicit Handler(Communicator& comm) : comm(comm) {}
+        void stopAck() override { comm.sendStopAck(true); }
+    private:
+        Communicator& comm;
+    };
+    Handler handler(comm);
+    comm.sendStopAck(false);
+    while (true) {
+        comm.poll(handler);
+        if (comm.hasStopAck())
+            break;
+        sched.yield(0);
+    }
+    sched.deactivate();
+    nodes = sc.getTotalNodes();
+}
+
+void
+SearchTest::testDeterministicSearch() {
+    const std::string fen = "r2q1rk1/pp2ppbp/2np1np1/8/3NP1b1/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9";
+    for (const char* mode : { "Jobs", "Lazy" }) {
+        UciParams::smpMode->set(mode);
+        Move bestM1, bestM2;
+        S64 nodes1, nodes2;
+        deterministicSearch(fen, 4, 100000, bestM1, nodes1);
+        deterministicSearch(fen, 4, 100000, bestM2, nodes2);
+        EXPECT_GT(nodes1, 0) << mode;
+        EXPECT_EQ(nodes1, nodes2) << mode;
+        EXPECT_EQ(TextIO::moveToUCIString(bestM1), TextIO::moveToUCIString(bestM2)) << mode;
+    }
+    UciParams::smpMode->set("Jobs");
+}
@@ -42,6 +42,7 @@ public:
     static void testNegaScout();
     static void testDraw50();
     static void testDrawRep();
+    static void testUpcomingRep();
     static void testHashing();
     static void testLMP();
     static void testCheckEvasion();
@@ -52,9 +53,13 @@ public:
     static void testScoreMoveList();
     static void testTBSearch();
     static void testFortress();
+    static void testLazySMP();
+    static void testDeterministicSearch();
 
 private:
     static int getSEE(Search& sc, const Move& m);
+    static void deterministicSearch(const std::string& fen, int nThreads, int maxNodes,
+                                    Move& bestM, S64& nodes);
 };
 
 #endif /* SEARCHTEST_HPP_ */
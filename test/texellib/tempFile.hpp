@@ -0,0 +1,71 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * tempFile.hpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: petero
+ */
+
+#ifndef TEMPFILE_HPP_
+#define TEMPFILE_HPP_
+
+#include "util.hpp"
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+/** A temporary file name that is unique for the current process.
+ *  The file is removed when this object is destroyed. */
+class TempFile {
+public:
+    explicit TempFile(const std::string& baseName) {
+#ifdef _WIN32
+        const char* dir = getenv("TEMP");
+        int pid = _getpid();
+        const char sep = '\\';
+#else
+        const char* dir = getenv("TMPDIR");
+        int pid = getpid();
+        const char sep = '/';
+#endif
+        std::string d = (dir && *dir) ? dir : (sep == '/' ? "/tmp" : ".");
+        if (d.back() != sep)
+            d += sep;
+        name = d + baseName + "_" + num2Str(pid);
+    }
+    ~TempFile() {
+        remove(name.c_str());
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& getName() const { return name; }
+
+private:
+    std::string name;
+};
+
+#endif /* TEMPFILE_HPP_ */
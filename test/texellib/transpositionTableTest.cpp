@@ -27,6 +27,7 @@
 #include "position.hpp"
 #include "textio.hpp"
 #include "searchTest.hpp"
+#include "tempFile.hpp"
 #include <iostream>
 
 #include "gtest/gtest.h"
@@ -166,6 +167,105 @@ TEST(TranspositionTableTest, testInsert) {
     }
 }
 
+/**
+ * Test that all entries in a bucket are used and that the
+ * least valuable entry is replaced when the bucket is full.
+ */
+TEST(TranspositionTableTest, testBucket) {
+    TranspositionTable tt(64*1024);
+    const U64 baseKey = 0x123456789abcdef0ULL & ~(0x1fffffULL << 27);
+    auto getKey = [baseKey](int i) -> U64 { return baseKey | ((U64)(i + 1) << 27); };
+    Move m(Square(E2), Square(E4), Piece::EMPTY);
+    const int n = 6;
+    for (int i = 0; i < n; i++) {
+        m.setScore(i * 10);
+        tt.insert(getKey(i), m, TType::T_EXACT, 0, 10 + i, i);
+    }
+    for (int i = 0; i < n; i++) {
+        TranspositionTable::TTEntry ent;
+        tt.probe(getKey(i), ent);
+        EXPECT_EQ(TType::T_EXACT, ent.getType());
+        EXPECT_EQ(getKey(i), ent.getKey());
+        EXPECT_EQ(i * 10, ent.getScore(0));
+        EXPECT_EQ(10 + i, ent.getDepth());
+        EXPECT_EQ(i, ent.getEvalScore());
+    }
+
+    // Bucket full, shallowest entry is replaced
+    m.setScore(17);
+    tt.insert(getKey(n), m, TType::T_EXACT, 0, 20, 0);
+    TranspositionTable::TTEntry ent;
+    tt.probe(getKey(n), ent);
+    EXPECT_EQ(TType::T_EXACT, ent.getType());
+    EXPECT_EQ(17, ent.getScore(0));
+    tt.probe(getKey(0), ent);
+    EXPECT_EQ(TType::T_EMPTY, ent.getType());
+    for (int i = 1; i < n; i++) {
+        tt.probe(getKey(i), ent);
+        EXPECT_EQ(TType::T_EXACT, ent.getType());
+    }
+}
+
+TEST(TranspositionTableTest, testStats) {
+    TranspositionTable tt(64*1024);
+    auto stats = tt.newThreadStats();
+    auto stats2 = tt.newThreadStats();
+    EXPECT_EQ(0, (U64)stats.get() % 64); // Per-thread counters do not share cache lines
+    EXPECT_EQ(0, (U64)stats2.get() % 64);
+    Move m(Square(E2), Square(E4), Piece::EMPTY);
+    TranspositionTable::TTEntry ent;
+    tt.probe(17, ent, stats.get());
+    tt.insert(17, m, TType::T_EXACT, 0, 5, 0, false, stats.get());
+    tt.probe(17, ent, stats.get());
+    tt.insert(17, m, TType::T_EXACT, 0, 3, 0, false, stats.get());
+    tt.insert(17, m, TType::T_EXACT, 0, 7, 0, false, stats.get());
+
+    TranspositionTable::Stats total;
+    tt.getStats(total);
+    EXPECT_EQ(2, total.probes);
+    EXPECT_EQ(1, total.hits);
+    EXPECT_EQ(2, total.stores);
+    EXPECT_EQ(1, total.notStored);
+    EXPECT_EQ(1, total.replaced[TranspositionTable::Stats::EMPTY]);
+    EXPECT_EQ(1, total.replaced[TranspositionTable::Stats::SAME_KEY]);
+
+    tt.resetStats();
+    tt.getStats(total);
+    EXPECT_EQ(0, total.probes);
+    stats.reset();
+    tt.probe(17, ent);
+    tt.getStats(total);
+    EXPECT_EQ(0, total.probes);
+}
+
+TEST(TranspositionTableTest, testSnapshot) {
+    TempFile tmpFile("texel_tt_snapshot.bin");
+    const std::string& fileName = tmpFile.getName();
+    TranspositionTable tt(64*1024);
+    tt.setWhiteContempt(10);
+    tt.nextGeneration();
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    Move m = TextIO::stringToMove(pos, "e4");
+    m.setScore(17);
+    tt.insert(pos.historyHash(), m, TType::T_EXACT, 0, 5, 3);
+    ASSERT_TRUE(tt.saveSnapshot(fileName));
+
+    TranspositionTable tt2(64*1024);
+    ASSERT_TRUE(tt2.loadSnapshot(fileName, 2));
+    TranspositionTable::TTEntry ent;
+    tt2.probe(pos.historyHash(), ent);
+    EXPECT_EQ(TType::T_EXACT, ent.getType());
+    EXPECT_EQ(17, ent.getScore(0));
+    EXPECT_EQ(5, ent.getDepth());
+    EXPECT_EQ(3, ent.getEvalScore());
+    EXPECT_EQ(1, ent.getGeneration());
+
+    // Snapshot from a table of different size is rejected
+    TranspositionTable tt3(128*1024);
+    EXPECT_FALSE(tt3.loadSnapshot(fileName));
+    EXPECT_FALSE(tt3.loadSnapshot(fileName + ".missing"));
+}
+
 /**
  * Test special depth logic for mate scores.
  */